@@ -0,0 +1,100 @@
+/**
+ * internal/cpu.hpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RANDOM_PERMUTATION_CPU_HPP
+#define _RANDOM_PERMUTATION_CPU_HPP
+
+#include <atomic>
+
+// kernels are built for several instruction set levels and picked at runtime
+// the features are added to those of the build rather than replacing them, so intrinsics can be inlined under -march=native
+// they must match the features tested by detect_isa_level, which is why LZCNT and MOVBE of the full levels are left out
+#if defined(__x86_64__)
+#define RANDOM_PERMUTATION_X86_64
+#define RANDOM_PERMUTATION_TARGET_V3 __attribute__((target("avx2,bmi,bmi2,fma")))
+#define RANDOM_PERMUTATION_TARGET_V4 __attribute__((target("avx2,bmi,bmi2,fma,avx512f,avx512bw,avx512cd,avx512dq,avx512vl")))
+#endif
+
+namespace random_permutation {
+
+/**
+ * \brief Instruction set levels for which kernels are built
+ */
+enum class IsaLevel : unsigned {
+    baseline = 0,  ///< no extensions assumed (x86-64 or any other architecture)
+    x86_64_v3 = 3, ///< AVX2, BMI2 and FMA
+    x86_64_v4 = 4, ///< AVX-512 (F, BW, CD, DQ and VL)
+};
+
+namespace internal {
+
+inline IsaLevel detect_isa_level() {
+#ifdef RANDOM_PERMUTATION_X86_64
+    __builtin_cpu_init();
+    bool const v3 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("fma");
+    bool const v4 = v3 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512cd")
+                       && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+    return v4 ? IsaLevel::x86_64_v4 : (v3 ? IsaLevel::x86_64_v3 : IsaLevel::baseline);
+#else
+    return IsaLevel::baseline;
+#endif
+}
+
+inline std::atomic<IsaLevel>& isa_level_limit() {
+    static std::atomic<IsaLevel> limit = IsaLevel::x86_64_v4;
+    return limit;
+}
+
+}
+
+/**
+ * \brief Returns the instruction set level used by the kernels
+ * 
+ * This is the highest level supported by the CPU, as detected on first use, unless limited using \ref limit_isa_level.
+ * 
+ * \return the instruction set level used by the kernels
+ */
+inline IsaLevel isa_level() {
+    static IsaLevel const detected = internal::detect_isa_level();
+    IsaLevel const limit = internal::isa_level_limit().load(std::memory_order_relaxed);
+    return (detected < limit) ? detected : limit;
+}
+
+/**
+ * \brief Limits the instruction set level used by the kernels
+ * 
+ * This is mainly useful for benchmarking and testing fallbacks. The results are the same for all levels.
+ * 
+ * \param limit the highest level to use
+ */
+inline void limit_isa_level(IsaLevel const limit) {
+    internal::isa_level_limit().store(limit, std::memory_order_relaxed);
+}
+
+}
+
+#endif
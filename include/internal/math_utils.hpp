@@ -28,8 +28,12 @@
 #ifndef _RANDOM_PERMUTATION_MATH_UTILS_HPP
 #define _RANDOM_PERMUTATION_MATH_UTILS_HPP
 
+#include <algorithm>
+#include <array>
 #include <bit>
 #include <cstdint>
+#include <limits>
+#include <type_traits>
 
 namespace random_permutation::internal {
 
@@ -41,6 +45,30 @@ namespace random_permutation::internal {
  */
 constexpr uint64_t pow2(int x) { return uint64_t(1) << x; }
 
+// the unsigned integer type of twice the width, used for products
+template<typename UInt> struct wide;
+template<> struct wide<uint16_t> { using type = uint32_t; };
+template<> struct wide<uint32_t> { using type = uint64_t; };
+template<> struct wide<uint64_t> { using type = __uint128_t; };
+
+template<typename UInt> using wide_t = typename wide<UInt>::type;
+
+// multiplies modulo 2^w for the bit width w of UInt, without narrow types being promoted to (signed) int
+template<typename UInt>
+constexpr UInt mul_lo(UInt const a, UInt const b) {
+    using Promoted = std::common_type_t<UInt, unsigned>;
+    return UInt(Promoted(a) * Promoted(b));
+}
+
+// computes the inverse of an odd number modulo 2^w for the bit width w of UInt
+template<typename UInt>
+constexpr UInt inverse_mod_2k(UInt const q) {
+    // Newton's iteration - every step doubles the number of correct low bits, starting with three
+    UInt inv = q;
+    for(unsigned bits = 3; bits < unsigned(std::numeric_limits<UInt>::digits); bits *= 2) inv = mul_lo(inv, UInt(UInt(2) - mul_lo(q, inv)));
+    return inv;
+}
+
 /**
  * \brief Computes the integer square root of the given number (rounded down)
  * 
@@ -75,56 +103,251 @@ constexpr uint64_t isqrt_ceil(uint64_t const x) {
     return r + (r * r < x);
 }
 
-// the first 54 prime numbers -- should fit into a cache line
-constexpr uint8_t SMALL_PRIMES[] = {
-    1,2,3,5,7,11,13,17,19,23,29,31,37,41,43,47,53,59,61,67,71,73,79,83,89,97,101,
-    103,107,109,113,127,131,137,139,149,151,157,163,167,173,179,181,191,193,197,199,
-    211,223,227,229,233,239,241,251
+// a divisibility test for an odd divisor q (Granlund and Montgomery, 1994):
+// x is a multiple of q if and only if x * q^-1 mod 2^64 <= (2^64-1) / q
+struct Divisor {
+    uint64_t inverse; // the inverse of q modulo 2^64
+    uint64_t limit;   // (2^64-1) / q
+
+    constexpr Divisor() : inverse(0), limit(0) {}
+
+    constexpr Divisor(uint64_t const q) : inverse(inverse_mod_2k(q)), limit(UINT64_MAX / q) {}
+
+    constexpr bool divides(uint64_t const x) const { return x * inverse <= limit; }
+};
+
+// the number of odd primes that candidates are screened against
+constexpr unsigned NUM_SMALL_PRIMES = 255;
+
+// the odd primes 3, 5, 7, ..., 1619
+constexpr std::array<uint16_t, NUM_SMALL_PRIMES> make_small_primes() {
+    std::array<uint16_t, NUM_SMALL_PRIMES> primes;
+    unsigned n = 0;
+    for(uint16_t q = 3; n < NUM_SMALL_PRIMES; q += 2) {
+        bool prime = true;
+        for(unsigned j = 0; j < n && prime; j++) prime = (q % primes[j]) != 0;
+        if(prime) primes[n++] = q;
+    }
+    return primes;
+}
+
+constexpr auto SMALL_PRIMES = make_small_primes();
+
+// divisibility tests for the small primes
+constexpr std::array<Divisor, NUM_SMALL_PRIMES> make_small_prime_divisors() {
+    std::array<Divisor, NUM_SMALL_PRIMES> divisors;
+    for(unsigned j = 0; j < NUM_SMALL_PRIMES; j++) divisors[j] = Divisor(SMALL_PRIMES[j]);
+    return divisors;
+}
+
+constexpr auto SMALL_PRIME_DIVISORS = make_small_prime_divisors();
+
+// numbers below this without a small prime factor are prime
+constexpr uint64_t SMALL_PRIME_BOUND = 1621ULL * 1621ULL;
+
+// arithmetic modulo an odd number n in Montgomery form, where x is represented by x * R mod n for R = 2^w
+// and the bit width w of UInt
+template<typename UInt>
+class MontgomeryForm {
+private:
+    using Wide = wide_t<UInt>;
+    static constexpr unsigned W = std::numeric_limits<UInt>::digits;
+
+    UInt n_;
+    UInt inv_; // the inverse of n modulo R
+    UInt r2_;  // R^2 mod n
+
+public:
+    constexpr MontgomeryForm() : n_(0), inv_(0), r2_(0) {}
+
+    constexpr MontgomeryForm(UInt const n) : n_(n), inv_(inverse_mod_2k(n)), r2_(0) {
+        UInt const r = UInt(UInt(0) - n) % n; // R mod n
+        r2_ = (Wide(r) * Wide(r)) % Wide(n);
+    }
+
+    // restores the form from previously computed constants
+    constexpr MontgomeryForm(UInt const n, UInt const inv, UInt const r2) : n_(n), inv_(inv), r2_(r2) {}
+
+    // computes t * R^-1 mod n for t < n * R
+    constexpr UInt redc(Wide const t) const {
+        UInt const m = mul_lo(UInt(t), inv_);
+        UInt const mn = (Wide(m) * Wide(n_)) >> W;
+        UInt const th = t >> W;
+        return th - mn + (th < mn ? n_ : UInt(0));
+    }
+
+    // converts x < n into Montgomery form
+    constexpr UInt to(UInt const x) const { return redc(Wide(x) * Wide(r2_)); }
+
+    // converts x from Montgomery form
+    constexpr UInt from(UInt const x) const { return redc(x); }
+
+    // computes the product of a and b, both in Montgomery form
+    constexpr UInt mul(UInt const a, UInt const b) const { return redc(Wide(a) * Wide(b)); }
+
+    constexpr UInt modulus() const { return n_; }
+    constexpr UInt inverse() const { return inv_; }
+    constexpr UInt r2() const { return r2_; }
 };
-constexpr unsigned NUM_SMALL_PRIMES = 55;
 
+// the bases that make the Miller-Rabin test deterministic for all 64-bit numbers (Jim Sinclair, 2011)
+constexpr uint64_t MILLER_RABIN_BASES[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+
+// tests whether an odd number with no small prime factor is prime using a deterministic Miller-Rabin test
+constexpr bool miller_rabin(uint64_t const p) {
+    // write p-1 = d * 2^s for an odd d
+    unsigned const s = std::countr_zero(p - 1);
+    uint64_t const d = (p - 1) >> s;
+
+    MontgomeryForm<uint64_t> const mf(p);
+    uint64_t const one = mf.to(1);
+    uint64_t const minus_one = p - one;
+    for(uint64_t const base : MILLER_RABIN_BASES) {
+        uint64_t const a = base % p;
+        if(a == 0) continue; // the base is a multiple of p and proves nothing
+
+        // compute a^d
+        uint64_t x = one;
+        for(uint64_t b = mf.to(a), e = d; e; e >>= 1) {
+            if(e & 1) x = mf.mul(x, b);
+            b = mf.mul(b, b);
+        }
+        if(x == one || x == minus_one) continue;
+
+        // square until -1 is found, otherwise p is composite
+        unsigned r = 1;
+        for(; r < s; r++) {
+            x = mf.mul(x, x);
+            if(x == minus_one) break;
+        }
+        if(r == s) return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Tests whether the given number is prime
+ * 
+ * Divisibility by small primes is tested first, then a deterministic Miller-Rabin test is performed.
+ * 
+ * \param p the number in question
+ * \return true if the number is prime, false otherwise
+ */
 constexpr bool is_prime(uint64_t const p) {
-    if(p % 2 == 0) {
-        return false;
-    } else {    
-        uint64_t const m = isqrt_ceil(p);
-        uint64_t i;
-
-        // first, check against small primes less than sqrt(p)
-        {
-            unsigned j = 2;
-            i = SMALL_PRIMES[j];
-            while(i <= m && j < NUM_SMALL_PRIMES - 1) {
-                if((p % i) == 0) return false;
-                i = SMALL_PRIMES[++j];
-            }
+    if(p < 2) return false;
+
+    // check against small primes
+    if(p % 2 == 0) return p == 2;
+    for(Divisor const& q : SMALL_PRIME_DIVISORS) {
+        if(q.divides(p)) return p * q.inverse == 1; // p is prime only if it equals q
+    }
+    if(p < SMALL_PRIME_BOUND) return true; // no prime factor less than sqrt(p)
+
+    return miller_rabin(p);
+}
+
+// the number of candidates sieved at once - there is almost always a prime among them
+constexpr uint64_t SIEVE_WINDOW = 256;
+
+// the number of small primes used for sieving, i.e., 3 to 251
+// larger ones remove only few candidates from a window, which does not make up for computing their offsets
+constexpr unsigned NUM_SIEVE_PRIMES = 54;
+
+// the greatest prime used for sieving
+constexpr uint64_t MAX_SIEVE_PRIME = SMALL_PRIMES[NUM_SIEVE_PRIMES - 1];
+
+/**
+ * \brief A window of the candidates top, top-stride, ..., top-(n-1)*stride that has been sieved by small primes
+ */
+struct SieveWindow {
+    uint64_t top;
+    uint64_t stride;
+    uint64_t n;
+    std::array<uint8_t, SIEVE_WINDOW> composite;
+
+    /**
+     * \brief Sieves the given candidates
+     * 
+     * \param top the greatest candidate, which must be odd
+     * \param stride the distance between two candidates, which must be 2 or 4
+     * \param n the number of candidates, at most \ref SIEVE_WINDOW, all of which must be greater than \ref MAX_SIEVE_PRIME
+     */
+    constexpr SieveWindow(uint64_t const top, uint64_t const stride, uint64_t const n) : top(top), stride(stride), n(n), composite() {
+        for(unsigned j = 0; j < NUM_SIEVE_PRIMES; j++) {
+            // candidate i is top - i * stride, which is a multiple of q if i = top / stride (mod q)
+            uint64_t const q = SMALL_PRIMES[j];
+            uint64_t i = top % q;
+            for(uint64_t k = stride; k > 1; k >>= 1) i = (i + (q & (0ULL - (i & 1)))) >> 1; // halve modulo q
+            for(; i < n; i += q) composite[i] = 1;
         }
+    }
 
-        // afterwards, use a folklore algorithm for i less than sqrt(p)
-        i = 5ULL + ((i - 5ULL) / 6ULL) * 6ULL;
-        while(i <= m) {
-            if(((p % i) == 0) || (p % (i+2) == 0)) return false;
-            i += 6ULL;
+    /**
+     * \brief Finds the greatest prime among the candidates, starting from the i-th
+     * 
+     * Only the survivors of the sieve are tested using Miller-Rabin. Those found to be composite are marked,
+     * so they are not tested again.
+     * 
+     * \param i the index of the candidate to start from
+     * \return the greatest prime among the candidates from the i-th on, or zero if there is none
+     */
+    constexpr uint64_t find(uint64_t i) {
+        constexpr uint64_t bound = (MAX_SIEVE_PRIME + 2) * (MAX_SIEVE_PRIME + 2); // survivors below are prime
+        for(; i < n; i++) {
+            if(!composite[i]) {
+                uint64_t const p = top - i * stride;
+                if(p < bound || miller_rabin(p)) return p;
+                composite[i] = 1;
+            }
         }
-        return true;
+        return 0;
+    }
+};
+
+/**
+ * \brief Finds the greatest prime among the candidates top, top-stride, ..., top-(n-1)*stride using a sieve
+ * 
+ * \param top the greatest candidate, which must be odd
+ * \param stride the distance between two candidates, which must be 2 or 4
+ * \param n the number of candidates, at most \ref SIEVE_WINDOW, all of which must be greater than \ref MAX_SIEVE_PRIME
+ * \return the greatest prime among the candidates, or zero if there is none
+ */
+constexpr uint64_t sieve_window(uint64_t const top, uint64_t const stride, uint64_t const n) {
+    return SieveWindow(top, stride, n).find(0);
+}
+
+/**
+ * \brief Finds the greatest prime among the candidates top, top-stride, top-2*stride, ... using a segmented sieve
+ * 
+ * \param top the greatest candidate, which must be odd
+ * \param stride the distance between two candidates, which must be 2 or 4
+ * \return the greatest prime among the candidates, or zero if there is none
+ */
+constexpr uint64_t sieve_prime_predecessor(uint64_t top, uint64_t const stride) {
+    while(top > MAX_SIEVE_PRIME) {
+        // sieve candidates greater than all sieving primes, so none of them is marked as a multiple of itself
+        uint64_t const n = std::min(SIEVE_WINDOW, (top - MAX_SIEVE_PRIME - 1) / stride + 1);
+        uint64_t const p = sieve_window(top, stride, n);
+        if(p) return p;
+        top -= n * stride;
+    }
+
+    // only small primes are left
+    for(; top >= 3; top -= stride) {
+        if(is_prime(top)) return top;
     }
+    return 0;
 }
 
 /**
  * \brief Finds the greatest prime number less than or equal to the given number
  * 
  * \param p the number to start searching from
- * \return the greatest prime number less than or equal to the given number
+ * \return the greatest prime number less than or equal to the given number, or zero if there is none
  */
-constexpr uint64_t prime_predecessor(uint64_t p) {
-    if(p == 0)[[unlikely]] return 0;
-    if(p == 2)[[unlikely]] return 2;
-    if(p % 2 == 0) --p; // all primes > 2 are odd
-
-    // linear search - the gap between two primes is hopefully very low
-    // in the worst case, because there must be a prime between p and 2p, this takes p steps
-    while(!is_prime(p)) p -= 2;
-    return p;
+constexpr uint64_t prime_predecessor(uint64_t const p) {
+    if(p < 3)[[unlikely]] return (p == 2) ? 2 : 0;
+    return sieve_prime_predecessor(p - 1 + (p & 1), 2); // all primes > 2 are odd
 }
 
 }
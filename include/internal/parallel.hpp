@@ -0,0 +1,133 @@
+/**
+ * internal/parallel.hpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RANDOM_PERMUTATION_PARALLEL_HPP
+#define _RANDOM_PERMUTATION_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <exception>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace random_permutation {
+
+namespace internal {
+
+// the number of positions processed by a thread at a time, small enough for a buffer of them to stay in the L2 cache
+constexpr uint64_t PARALLEL_CHUNK = 1ULL << 14;
+
+// distributes the positions in [first, last) among threads in chunks, which the threads claim in increasing order
+// every thread obtains its own worker from make_worker and calls it as worker(begin, end) for every chunk it claims
+// an exception thrown by a worker stops the claiming, and the first one is rethrown after all threads have finished
+template<typename MakeWorker>
+void parallel_chunks(uint64_t const first, uint64_t const last, unsigned const threads, MakeWorker&& make_worker) {
+    if(last <= first) return;
+
+    uint64_t const n = last - first;
+    uint64_t const num_chunks = n / PARALLEL_CHUNK + (n % PARALLEL_CHUNK != 0);
+    unsigned const num_threads = unsigned(std::min<uint64_t>(threads ? threads : std::max(1U, std::thread::hardware_concurrency()), num_chunks));
+
+    std::atomic<uint64_t> next = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+
+    auto run = [&]() {
+        try {
+            auto worker = make_worker();
+            for(uint64_t c = next.fetch_add(1, std::memory_order_relaxed); c < num_chunks; c = next.fetch_add(1, std::memory_order_relaxed)) {
+                uint64_t const begin = first + c * PARALLEL_CHUNK;
+                worker(begin, begin + std::min(last - begin, PARALLEL_CHUNK));
+            }
+        } catch(...) {
+            if(!failed.exchange(true)) error = std::current_exception();
+            next.store(num_chunks, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(unsigned t = 1; t < num_threads; t++) workers.emplace_back(run);
+    run();
+    for(auto& worker : workers) worker.join();
+
+    if(error) std::rethrow_exception(error);
+}
+
+}
+
+/**
+ * \brief Calls a function for the numbers of a permutation at the given positions using multiple threads
+ * 
+ * The positions are split into chunks that the threads claim one after another, and each chunk is computed using the permutation's \c fill.
+ * The function is called exactly once per position, in no particular order and concurrently from multiple threads,
+ * so the results do not depend on the number of threads as long as the function writes only to per-position state.
+ * 
+ * \param perm the permutation
+ * \param first the first position
+ * \param last the position after the last one
+ * \param f the function, called as f(i, x) for every position i with x being the i-th number of the permutation
+ * \param threads the number of threads, 0 for all hardware threads
+ */
+template<typename Perm, typename F>
+requires std::invocable<F&, typename Perm::value_type, typename Perm::value_type>
+void parallel_for_each(Perm const& perm, typename Perm::value_type const first, typename Perm::value_type const last, F&& f, unsigned const threads = 0) {
+    using UInt = typename Perm::value_type;
+    internal::parallel_chunks(first, last, threads, [&]() {
+        return [&, buffer = std::vector<UInt>(internal::PARALLEL_CHUNK)](uint64_t const begin, uint64_t const end) mutable {
+            size_t const n = size_t(end - begin);
+            perm.fill(UInt(begin), std::span<UInt>(buffer.data(), n));
+            for(size_t i = 0; i < n; i++) f(UInt(begin + i), buffer[i]);
+        };
+    });
+}
+
+/**
+ * \brief Computes the first numbers of a permutation using multiple threads
+ * 
+ * The output is split into chunks that the threads claim one after another, and each chunk is computed using the permutation's \c fill.
+ * The result is the same as that of \c fill and does not depend on the number of threads.
+ * 
+ * \param perm the permutation
+ * \param out the output, which receives the permuted numbers of 0, 1, ..., out.size()-1
+ * \param threads the number of threads, 0 for all hardware threads
+ */
+template<typename Perm>
+void parallel_fill(Perm const& perm, std::span<typename Perm::value_type> const out, unsigned const threads = 0) {
+    using UInt = typename Perm::value_type;
+    internal::parallel_chunks(0, out.size(), threads, [&]() {
+        return [&](uint64_t const begin, uint64_t const end) {
+            perm.fill(UInt(begin), out.subspan(size_t(begin), size_t(end - begin)));
+        };
+    });
+}
+
+}
+
+#endif
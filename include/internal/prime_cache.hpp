@@ -0,0 +1,364 @@
+/**
+ * internal/prime_cache.hpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RANDOM_PERMUTATION_PRIME_CACHE_HPP
+#define _RANDOM_PERMUTATION_PRIME_CACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+
+// the persistent prime cache needs memory mapping and file locks
+#if __has_include(<sys/mman.h>) && __has_include(<sys/file.h>) && __has_include(<unistd.h>)
+#define RANDOM_PERMUTATION_DISK_CACHE
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace random_permutation {
+
+namespace internal {
+
+/**
+ * \brief A memory-mapped file that maps universes to their primes, shared by all processes that use it
+ * 
+ * The file contains a hash table with linear probing, the universes of which never change once written.
+ * Entries are written under an exclusive file lock, the universe last, so they can be read without locking.
+ * The file is not trusted: the primes read from it must be validated, and invalid ones are replaced using \ref insert.
+ * If the table runs full, new entries are no longer stored.
+ */
+class DiskPrimeCache {
+private:
+    static constexpr uint64_t MAGIC = 0x31454D4952505052ULL; // "RPPRIME1"
+    static constexpr unsigned MAX_PROBES = 64;
+
+    struct Header { uint64_t magic, capacity; };
+    struct Slot { uint64_t universe, prime; }; // universe zero marks an empty slot
+
+    int fd_;
+    void* map_;
+    size_t size_;
+    uint64_t mask_;
+    unsigned shift_; // 64 minus the binary logarithm of the capacity
+    Slot* slots_;
+    std::mutex write_mutex_; // file locks do not exclude threads of the same process
+
+    // the high bits of the product depend on all bits of the universe, the low bits only on the low bits
+    inline uint64_t home(uint64_t const universe) const { return (universe * 0x9E3779B97F4A7C15ULL) >> shift_; }
+
+public:
+    /**
+     * \brief Opens the given cache file, or creates it if it does not exist
+     * 
+     * \param path the path to the cache file
+     * \param capacity the number of entries of a new file, which is rounded up to a power of two
+     */
+    inline DiskPrimeCache(std::string const& path, uint64_t capacity) : fd_(-1), map_(nullptr), size_(0), mask_(0), shift_(0), slots_(nullptr) {
+#ifdef RANDOM_PERMUTATION_DISK_CACHE
+        int const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if(fd < 0) return;
+
+        // initialize a new file, or read the capacity of an existing one
+        bool ok = false;
+        if(::flock(fd, LOCK_EX) == 0) {
+            struct stat st;
+            Header header = { MAGIC, std::bit_ceil(capacity < 2 ? uint64_t(2) : capacity) };
+            if(::fstat(fd, &st) == 0) {
+                if(st.st_size == 0) {
+                    size_t const size = sizeof(Header) + header.capacity * sizeof(Slot);
+                    ok = ::ftruncate(fd, size) == 0 && ::pwrite(fd, &header, sizeof(Header), 0) == sizeof(Header);
+                } else {
+                    ok = ::pread(fd, &header, sizeof(Header), 0) == sizeof(Header) && header.magic == MAGIC
+                        && std::has_single_bit(header.capacity) && uint64_t(st.st_size) == sizeof(Header) + header.capacity * sizeof(Slot);
+                }
+            }
+            ::flock(fd, LOCK_UN);
+
+            if(ok) {
+                size_ = sizeof(Header) + header.capacity * sizeof(Slot);
+                map_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                ok = (map_ != MAP_FAILED);
+                if(ok) {
+                    mask_ = header.capacity - 1;
+                    shift_ = 64 - std::countr_zero(header.capacity);
+                    slots_ = (Slot*)((char*)map_ + sizeof(Header));
+                }
+            }
+        }
+
+        if(ok) {
+            fd_ = fd;
+        } else {
+            map_ = nullptr;
+            ::close(fd);
+        }
+#else
+        (void)path;
+        (void)capacity;
+#endif
+    }
+
+    DiskPrimeCache(DiskPrimeCache const&) = delete;
+    DiskPrimeCache& operator=(DiskPrimeCache const&) = delete;
+
+    inline ~DiskPrimeCache() {
+#ifdef RANDOM_PERMUTATION_DISK_CACHE
+        if(map_) ::munmap(map_, size_);
+        if(fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    /**
+     * \brief Reports whether the cache file has been opened successfully
+     * 
+     * \return true if the cache can be used, false otherwise
+     */
+    inline bool is_open() const { return fd_ >= 0; }
+
+    /**
+     * \brief Looks up the prime for the given universe
+     * 
+     * \param universe the universe, which must not be zero
+     * \param prime receives the prime, if the universe is contained
+     * \return true if the universe is contained, false otherwise
+     */
+    inline bool lookup(uint64_t const universe, uint64_t& prime) const {
+        for(uint64_t i = home(universe), k = 0; k < MAX_PROBES; i = (i + 1) & mask_, k++) {
+            uint64_t const u = std::atomic_ref<uint64_t>(slots_[i].universe).load(std::memory_order_acquire);
+            if(u == universe) {
+                prime = std::atomic_ref<uint64_t>(slots_[i].prime).load(std::memory_order_relaxed);
+                return true;
+            } else if(u == 0) {
+                break;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * \brief Stores the prime for the given universe, unless the table is full
+     * 
+     * If the universe is already contained with a different prime, the prime is replaced.
+     * 
+     * \param universe the universe, which must not be zero
+     * \param prime the prime
+     */
+    inline void insert(uint64_t const universe, uint64_t const prime) {
+#ifdef RANDOM_PERMUTATION_DISK_CACHE
+        std::lock_guard lock(write_mutex_);
+        if(::flock(fd_, LOCK_EX) != 0) return;
+        for(uint64_t i = home(universe), k = 0; k < MAX_PROBES; i = (i + 1) & mask_, k++) {
+            uint64_t const u = std::atomic_ref<uint64_t>(slots_[i].universe).load(std::memory_order_relaxed);
+            if(u == universe) {
+                // inserted by someone else in the meantime, or with an invalid prime
+                std::atomic_ref<uint64_t>(slots_[i].prime).store(prime, std::memory_order_relaxed);
+                break;
+            } else if(u == 0) {
+                std::atomic_ref<uint64_t>(slots_[i].prime).store(prime, std::memory_order_relaxed);
+                std::atomic_ref<uint64_t>(slots_[i].universe).store(universe, std::memory_order_release);
+                break;
+            }
+        }
+        ::flock(fd_, LOCK_UN);
+#else
+        (void)universe;
+        (void)prime;
+#endif
+    }
+};
+
+/**
+ * \brief A bounded in-memory cache that maps universes to their primes, safe for concurrent use
+ * 
+ * The cache is split into shards with a reader-writer lock each, and every shard is a two-way set-associative table.
+ * A new entry replaces the older of the two entries in its set, so two universes mapped to the same set do not evict each other.
+ */
+class MemoPrimeCache {
+private:
+    static constexpr unsigned SHARD_BITS = 4;
+    static constexpr unsigned SET_BITS = 7;
+    static constexpr unsigned WAYS = 2;
+
+    struct Slot { uint64_t universe, prime; }; // universe zero marks an empty slot
+    using Set = std::array<Slot, WAYS>;        // the newer entry comes first
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::array<Set, 1ULL << SET_BITS> sets = {};
+    };
+
+    std::array<Shard, 1ULL << SHARD_BITS> shards_;
+
+public:
+    /**
+     * \brief The maximum number of entries
+     */
+    static constexpr size_t CAPACITY = WAYS << (SHARD_BITS + SET_BITS);
+
+private:
+    inline Shard& shard(uint64_t const h) { return shards_[h >> (64 - SHARD_BITS)]; }
+    inline Shard const& shard(uint64_t const h) const { return shards_[h >> (64 - SHARD_BITS)]; }
+    static inline uint64_t hash(uint64_t const universe) { return universe * 0x9E3779B97F4A7C15ULL; }
+    static inline size_t set(uint64_t const h) { return (h >> (64 - SHARD_BITS - SET_BITS)) & ((1ULL << SET_BITS) - 1); }
+
+public:
+    /**
+     * \brief Looks up the prime for the given universe
+     * 
+     * \param universe the universe, which must not be zero
+     * \param prime receives the prime, if the universe is contained
+     * \return true if the universe is contained, false otherwise
+     */
+    inline bool lookup(uint64_t const universe, uint64_t& prime) const {
+        uint64_t const h = hash(universe);
+        Shard const& s = shard(h);
+        std::shared_lock lock(s.mutex);
+        for(Slot const& e : s.sets[set(h)]) {
+            if(e.universe == universe) {
+                prime = e.prime;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * \brief Stores the prime for the given universe
+     * 
+     * \param universe the universe, which must not be zero
+     * \param prime the prime
+     */
+    inline void insert(uint64_t const universe, uint64_t const prime) {
+        uint64_t const h = hash(universe);
+        Shard& s = shard(h);
+        std::unique_lock lock(s.mutex);
+        Set& e = s.sets[set(h)];
+        if(e[1].universe == universe) {
+            std::swap(e[0], e[1]);
+        } else if(e[0].universe != universe) {
+            e[1] = e[0]; // evict the older entry
+        }
+        e[0] = { universe, prime };
+    }
+
+    /**
+     * \brief Removes all entries
+     */
+    inline void clear() {
+        for(Shard& s : shards_) {
+            std::unique_lock lock(s.mutex);
+            s.sets = {};
+        }
+    }
+};
+
+// the process-wide prime caches, the mutex guards replacing the cache file
+struct PrimeCaches {
+    std::atomic<bool> memo_enabled = true;
+    MemoPrimeCache memo;
+
+    std::shared_mutex mutex;
+    std::unique_ptr<DiskPrimeCache> disk;
+};
+
+inline PrimeCaches& prime_caches() {
+    static PrimeCaches caches;
+    return caches;
+}
+
+}
+
+/**
+ * \brief The default number of entries of a new prime cache file
+ */
+constexpr uint64_t DEFAULT_PRIME_CACHE_CAPACITY = 1ULL << 16;
+
+/**
+ * \brief Enables a persistent prime cache file that is consulted and extended by all subsequently constructed permutations
+ * 
+ * The file is memory-mapped and may be shared by any number of processes at the same time.
+ * It is created if it does not exist. Universes for which the prime is known at compile time are not stored.
+ * If a cache file is already enabled, it is replaced.
+ * 
+ * This is supported only on POSIX systems.
+ * 
+ * \param path the path to the cache file
+ * \param capacity the maximum number of entries if the file is created, which is rounded up to a power of two
+ * \return true if the cache file could be opened, false otherwise
+ */
+inline bool enable_prime_cache(std::string const& path, uint64_t const capacity = DEFAULT_PRIME_CACHE_CAPACITY) {
+    auto disk = std::make_unique<internal::DiskPrimeCache>(path, capacity);
+    if(!disk->is_open()) return false;
+
+    auto& caches = internal::prime_caches();
+    std::unique_lock lock(caches.mutex);
+    caches.disk = std::move(disk);
+    return true;
+}
+
+/**
+ * \brief Disables the persistent prime cache file, if any
+ */
+inline void disable_prime_cache() {
+    auto& caches = internal::prime_caches();
+    std::unique_lock lock(caches.mutex);
+    caches.disk.reset();
+}
+
+/**
+ * \brief Enables the in-memory prime cache, which is enabled by default
+ * 
+ * The primes for the most recently used universes are kept in memory, so constructing further permutations
+ * for the same universes does not require a prime search.
+ * At most \ref internal::MemoPrimeCache::CAPACITY universes are remembered.
+ */
+inline void enable_prime_memo() {
+    internal::prime_caches().memo_enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Disables the in-memory prime cache and clears it
+ */
+inline void disable_prime_memo() {
+    auto& caches = internal::prime_caches();
+    caches.memo_enabled.store(false, std::memory_order_relaxed);
+    caches.memo.clear();
+}
+
+}
+
+#endif
@@ -0,0 +1,365 @@
+/**
+ * internal/prime_search.hpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RANDOM_PERMUTATION_PRIME_SEARCH_HPP
+#define _RANDOM_PERMUTATION_PRIME_SEARCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "math_utils.hpp"
+#include "prime_cache.hpp"
+
+namespace random_permutation {
+
+namespace internal {
+
+/**
+ * \brief Finds the largest prime p less than or equal to the given universe that satisfies p = (3 mod 4) by searching
+ * 
+ * \param universe the universe
+ * \return the largest prime p less than or equal to the universe that satisfies p = (3 mod 4), or zero if there is none
+ */
+constexpr uint64_t search_prime_3mod4(uint64_t const universe) {
+    // consider only candidates that satisfy (3 mod 4)
+    if(universe < 3) return 0;
+    return sieve_prime_predecessor(universe - ((universe - 3ULL) & 3ULL), 4);
+}
+
+// the number of threads used for prime searches at runtime
+inline std::atomic<unsigned>& prime_search_threads() {
+    static std::atomic<unsigned> threads = 1;
+    return threads;
+}
+
+/**
+ * \brief Same as \ref sieve_prime_predecessor, but distributes the windows among several threads
+ * 
+ * The first window almost always contains a prime, so it is searched without spawning any threads.
+ * Afterwards, the threads claim consecutive windows, and the first window that contains a prime wins.
+ * Windows after it are no longer searched once it has been found.
+ * 
+ * \param top the greatest candidate, which must be odd
+ * \param stride the distance between two candidates, which must be 2 or 4
+ * \param threads the number of threads to use
+ * \return the greatest prime among the candidates, or zero if there is none
+ */
+inline uint64_t parallel_sieve_prime_predecessor(uint64_t const top, uint64_t const stride, unsigned const threads) {
+    // only windows whose candidates are all greater than the sieving primes are distributed
+    uint64_t const num_windows = (top > MAX_SIEVE_PRIME) ? ((top - MAX_SIEVE_PRIME - 1) / stride + 1) / SIEVE_WINDOW : 0;
+    if(threads <= 1 || num_windows < 2) return sieve_prime_predecessor(top, stride);
+
+    if(uint64_t const p = sieve_window(top, stride, SIEVE_WINDOW)) return p;
+
+    std::atomic<uint64_t> next = 1;           // the next window to claim
+    std::atomic<uint64_t> found = num_windows; // the first window in which a prime has been found so far
+    std::vector<uint64_t> primes(num_windows < threads ? num_windows : threads, 0);
+    std::vector<uint64_t> windows(primes.size(), num_windows);
+
+    auto search = [&](size_t const t) {
+        for(uint64_t w = next.fetch_add(1, std::memory_order_relaxed); w < found.load(std::memory_order_relaxed); w = next.fetch_add(1, std::memory_order_relaxed)) {
+            uint64_t const p = sieve_window(top - w * SIEVE_WINDOW * stride, stride, SIEVE_WINDOW);
+            if(p) {
+                // every thread claims windows in increasing order, so this is the thread's first and best find
+                primes[t] = p;
+                windows[t] = w;
+                uint64_t f = found.load(std::memory_order_relaxed);
+                while(w < f && !found.compare_exchange_weak(f, w, std::memory_order_relaxed)) {}
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(size_t t = 1; t < primes.size(); t++) workers.emplace_back(search, t);
+    search(0);
+    for(auto& worker : workers) worker.join();
+
+    size_t best = 0;
+    for(size_t t = 1; t < primes.size(); t++) {
+        if(windows[t] < windows[best]) best = t;
+    }
+    if(primes[best]) return primes[best];
+
+    // continue below the distributed windows
+    return sieve_prime_predecessor(top - num_windows * SIEVE_WINDOW * stride, stride);
+}
+
+// a universe size and the corresponding prime that satisfies (3 mod 4), or zero if there is none
+struct CommonUniverse { uint64_t universe, prime; };
+
+// the common universes 2^k, 2^k-1 and 2^k-2 and 10^k, 10^k-1 and 10^k-2, sorted by universe
+// the primes have been computed using search_prime_3mod4 - computing them during compilation takes seconds per translation unit
+// the check target verifies all of them, a few are spot-checked below
+constexpr CommonUniverse COMMON_UNIVERSES[] = {
+    { 2ULL, 0ULL }, { 3ULL, 3ULL }, { 4ULL, 3ULL },
+    { 6ULL, 3ULL }, { 7ULL, 7ULL }, { 8ULL, 7ULL },
+    { 9ULL, 7ULL }, { 10ULL, 7ULL }, { 14ULL, 11ULL },
+    { 15ULL, 11ULL }, { 16ULL, 11ULL }, { 30ULL, 23ULL },
+    { 31ULL, 31ULL }, { 32ULL, 31ULL }, { 62ULL, 59ULL },
+    { 63ULL, 59ULL }, { 64ULL, 59ULL }, { 98ULL, 83ULL },
+    { 99ULL, 83ULL }, { 100ULL, 83ULL }, { 126ULL, 107ULL },
+    { 127ULL, 127ULL }, { 128ULL, 127ULL }, { 254ULL, 251ULL },
+    { 255ULL, 251ULL }, { 256ULL, 251ULL }, { 510ULL, 503ULL },
+    { 511ULL, 503ULL }, { 512ULL, 503ULL }, { 998ULL, 991ULL },
+    { 999ULL, 991ULL }, { 1000ULL, 991ULL }, { 1022ULL, 1019ULL },
+    { 1023ULL, 1019ULL }, { 1024ULL, 1019ULL }, { 2046ULL, 2039ULL },
+    { 2047ULL, 2039ULL }, { 2048ULL, 2039ULL }, { 4094ULL, 4091ULL },
+    { 4095ULL, 4091ULL }, { 4096ULL, 4091ULL }, { 8190ULL, 8179ULL },
+    { 8191ULL, 8191ULL }, { 8192ULL, 8191ULL }, { 9998ULL, 9967ULL },
+    { 9999ULL, 9967ULL }, { 10000ULL, 9967ULL }, { 16382ULL, 16363ULL },
+    { 16383ULL, 16363ULL }, { 16384ULL, 16363ULL }, { 32766ULL, 32719ULL },
+    { 32767ULL, 32719ULL }, { 32768ULL, 32719ULL }, { 65534ULL, 65519ULL },
+    { 65535ULL, 65519ULL }, { 65536ULL, 65519ULL }, { 99998ULL, 99991ULL },
+    { 99999ULL, 99991ULL }, { 100000ULL, 99991ULL }, { 131070ULL, 131063ULL },
+    { 131071ULL, 131071ULL }, { 131072ULL, 131071ULL }, { 262142ULL, 262139ULL },
+    { 262143ULL, 262139ULL }, { 262144ULL, 262139ULL }, { 524286ULL, 524243ULL },
+    { 524287ULL, 524287ULL }, { 524288ULL, 524287ULL }, { 999998ULL, 999983ULL },
+    { 999999ULL, 999983ULL }, { 1000000ULL, 999983ULL }, { 1048574ULL, 1048571ULL },
+    { 1048575ULL, 1048571ULL }, { 1048576ULL, 1048571ULL }, { 2097150ULL, 2097143ULL },
+    { 2097151ULL, 2097143ULL }, { 2097152ULL, 2097143ULL }, { 4194302ULL, 4194287ULL },
+    { 4194303ULL, 4194287ULL }, { 4194304ULL, 4194287ULL }, { 8388606ULL, 8388587ULL },
+    { 8388607ULL, 8388587ULL }, { 8388608ULL, 8388587ULL }, { 9999998ULL, 9999991ULL },
+    { 9999999ULL, 9999991ULL }, { 10000000ULL, 9999991ULL }, { 16777214ULL, 16777199ULL },
+    { 16777215ULL, 16777199ULL }, { 16777216ULL, 16777199ULL }, { 33554430ULL, 33554383ULL },
+    { 33554431ULL, 33554383ULL }, { 33554432ULL, 33554383ULL }, { 67108862ULL, 67108859ULL },
+    { 67108863ULL, 67108859ULL }, { 67108864ULL, 67108859ULL }, { 99999998ULL, 99999971ULL },
+    { 99999999ULL, 99999971ULL }, { 100000000ULL, 99999971ULL }, { 134217726ULL, 134217487ULL },
+    { 134217727ULL, 134217487ULL }, { 134217728ULL, 134217487ULL }, { 268435454ULL, 268435399ULL },
+    { 268435455ULL, 268435399ULL }, { 268435456ULL, 268435399ULL }, { 536870910ULL, 536870879ULL },
+    { 536870911ULL, 536870879ULL }, { 536870912ULL, 536870879ULL }, { 999999998ULL, 999999883ULL },
+    { 999999999ULL, 999999883ULL }, { 1000000000ULL, 999999883ULL }, { 1073741822ULL, 1073741783ULL },
+    { 1073741823ULL, 1073741783ULL }, { 1073741824ULL, 1073741783ULL }, { 2147483646ULL, 2147483587ULL },
+    { 2147483647ULL, 2147483647ULL }, { 2147483648ULL, 2147483647ULL }, { 4294967294ULL, 4294967291ULL },
+    { 4294967295ULL, 4294967291ULL }, { 4294967296ULL, 4294967291ULL }, { 8589934590ULL, 8589934583ULL },
+    { 8589934591ULL, 8589934583ULL }, { 8589934592ULL, 8589934583ULL }, { 9999999998ULL, 9999999967ULL },
+    { 9999999999ULL, 9999999967ULL }, { 10000000000ULL, 9999999967ULL }, { 17179869182ULL, 17179869143ULL },
+    { 17179869183ULL, 17179869143ULL }, { 17179869184ULL, 17179869143ULL }, { 34359738366ULL, 34359738319ULL },
+    { 34359738367ULL, 34359738319ULL }, { 34359738368ULL, 34359738319ULL }, { 68719476734ULL, 68719476731ULL },
+    { 68719476735ULL, 68719476731ULL }, { 68719476736ULL, 68719476731ULL }, { 99999999998ULL, 99999999947ULL },
+    { 99999999999ULL, 99999999947ULL }, { 100000000000ULL, 99999999947ULL }, { 137438953470ULL, 137438953447ULL },
+    { 137438953471ULL, 137438953447ULL }, { 137438953472ULL, 137438953447ULL }, { 274877906942ULL, 274877906899ULL },
+    { 274877906943ULL, 274877906899ULL }, { 274877906944ULL, 274877906899ULL }, { 549755813886ULL, 549755813723ULL },
+    { 549755813887ULL, 549755813723ULL }, { 549755813888ULL, 549755813723ULL }, { 999999999998ULL, 999999999959ULL },
+    { 999999999999ULL, 999999999959ULL }, { 1000000000000ULL, 999999999959ULL }, { 1099511627774ULL, 1099511627563ULL },
+    { 1099511627775ULL, 1099511627563ULL }, { 1099511627776ULL, 1099511627563ULL }, { 2199023255550ULL, 2199023255531ULL },
+    { 2199023255551ULL, 2199023255531ULL }, { 2199023255552ULL, 2199023255531ULL }, { 4398046511102ULL, 4398046511087ULL },
+    { 4398046511103ULL, 4398046511087ULL }, { 4398046511104ULL, 4398046511087ULL }, { 8796093022206ULL, 8796093022151ULL },
+    { 8796093022207ULL, 8796093022151ULL }, { 8796093022208ULL, 8796093022151ULL }, { 9999999999998ULL, 9999999999971ULL },
+    { 9999999999999ULL, 9999999999971ULL }, { 10000000000000ULL, 9999999999971ULL }, { 17592186044414ULL, 17592186044399ULL },
+    { 17592186044415ULL, 17592186044399ULL }, { 17592186044416ULL, 17592186044399ULL }, { 35184372088830ULL, 35184372088763ULL },
+    { 35184372088831ULL, 35184372088763ULL }, { 35184372088832ULL, 35184372088763ULL }, { 70368744177662ULL, 70368744177643ULL },
+    { 70368744177663ULL, 70368744177643ULL }, { 70368744177664ULL, 70368744177643ULL }, { 99999999999998ULL, 99999999999971ULL },
+    { 99999999999999ULL, 99999999999971ULL }, { 100000000000000ULL, 99999999999971ULL }, { 140737488355326ULL, 140737488355031ULL },
+    { 140737488355327ULL, 140737488355031ULL }, { 140737488355328ULL, 140737488355031ULL }, { 281474976710654ULL, 281474976710591ULL },
+    { 281474976710655ULL, 281474976710591ULL }, { 281474976710656ULL, 281474976710591ULL }, { 562949953421310ULL, 562949953421231ULL },
+    { 562949953421311ULL, 562949953421231ULL }, { 562949953421312ULL, 562949953421231ULL }, { 999999999999998ULL, 999999999999947ULL },
+    { 999999999999999ULL, 999999999999947ULL }, { 1000000000000000ULL, 999999999999947ULL }, { 1125899906842622ULL, 1125899906842511ULL },
+    { 1125899906842623ULL, 1125899906842511ULL }, { 1125899906842624ULL, 1125899906842511ULL }, { 2251799813685246ULL, 2251799813685119ULL },
+    { 2251799813685247ULL, 2251799813685119ULL }, { 2251799813685248ULL, 2251799813685119ULL }, { 4503599627370494ULL, 4503599627370323ULL },
+    { 4503599627370495ULL, 4503599627370323ULL }, { 4503599627370496ULL, 4503599627370323ULL }, { 9007199254740990ULL, 9007199254740847ULL },
+    { 9007199254740991ULL, 9007199254740847ULL }, { 9007199254740992ULL, 9007199254740847ULL }, { 9999999999999998ULL, 9999999999999887ULL },
+    { 9999999999999999ULL, 9999999999999887ULL }, { 10000000000000000ULL, 9999999999999887ULL }, { 18014398509481982ULL, 18014398509481951ULL },
+    { 18014398509481983ULL, 18014398509481951ULL }, { 18014398509481984ULL, 18014398509481951ULL }, { 36028797018963966ULL, 36028797018963799ULL },
+    { 36028797018963967ULL, 36028797018963799ULL }, { 36028797018963968ULL, 36028797018963799ULL }, { 72057594037927934ULL, 72057594037927931ULL },
+    { 72057594037927935ULL, 72057594037927931ULL }, { 72057594037927936ULL, 72057594037927931ULL }, { 99999999999999998ULL, 99999999999999943ULL },
+    { 99999999999999999ULL, 99999999999999943ULL }, { 100000000000000000ULL, 99999999999999943ULL }, { 144115188075855870ULL, 144115188075855859ULL },
+    { 144115188075855871ULL, 144115188075855859ULL }, { 144115188075855872ULL, 144115188075855859ULL }, { 288230376151711742ULL, 288230376151711687ULL },
+    { 288230376151711743ULL, 288230376151711687ULL }, { 288230376151711744ULL, 288230376151711687ULL }, { 576460752303423486ULL, 576460752303423263ULL },
+    { 576460752303423487ULL, 576460752303423263ULL }, { 576460752303423488ULL, 576460752303423263ULL }, { 999999999999999998ULL, 999999999999999967ULL },
+    { 999999999999999999ULL, 999999999999999967ULL }, { 1000000000000000000ULL, 999999999999999967ULL }, { 1152921504606846974ULL, 1152921504606846883ULL },
+    { 1152921504606846975ULL, 1152921504606846883ULL }, { 1152921504606846976ULL, 1152921504606846883ULL }, { 2305843009213693950ULL, 2305843009213693907ULL },
+    { 2305843009213693951ULL, 2305843009213693951ULL }, { 2305843009213693952ULL, 2305843009213693951ULL }, { 4611686018427387902ULL, 4611686018427387847ULL },
+    { 4611686018427387903ULL, 4611686018427387847ULL }, { 4611686018427387904ULL, 4611686018427387847ULL }, { 9223372036854775806ULL, 9223372036854775783ULL },
+    { 9223372036854775807ULL, 9223372036854775783ULL }, { 9223372036854775808ULL, 9223372036854775783ULL }, { 9999999999999999998ULL, 9999999999999999943ULL },
+    { 9999999999999999999ULL, 9999999999999999943ULL }, { 10000000000000000000ULL, 9999999999999999943ULL }, { 18446744073709551614ULL, 18446744073709551427ULL },
+    { 18446744073709551615ULL, 18446744073709551427ULL },
+};
+
+static_assert(std::ranges::is_sorted(COMMON_UNIVERSES, std::ranges::less(), &CommonUniverse::universe));
+static_assert(std::size(COMMON_UNIVERSES) == 244);
+static_assert(COMMON_UNIVERSES[std::size(COMMON_UNIVERSES) - 1].universe == UINT64_MAX && is_prime(COMMON_UNIVERSES[std::size(COMMON_UNIVERSES) - 1].prime));
+
+// finds the given universe in the table of common universes, returns nullptr if it is not common
+constexpr CommonUniverse const* find_common_universe(uint64_t const universe) {
+    auto const it = std::ranges::lower_bound(COMMON_UNIVERSES, universe, std::ranges::less(), &CommonUniverse::universe);
+    return (it != std::end(COMMON_UNIVERSES) && it->universe == universe) ? it : nullptr;
+}
+
+/**
+ * \brief Finds the largest prime p less than or equal to the given universe that satisfies p = (3 mod 4)
+ * 
+ * \param universe the universe
+ * \return the largest prime p less than or equal to the universe that satisfies p = (3 mod 4), or zero if there is none
+ */
+constexpr uint64_t prev_prime_3mod4(uint64_t const universe) {
+    // test if universe is common
+    if(auto const* common = find_common_universe(universe)) return common->prime;
+
+    // otherwise, do it the hard way
+    return search_prime_3mod4(universe);
+}
+
+// searches the largest prime p less than or equal to the given universe that satisfies p = (3 mod 4) using the configured number of threads
+inline uint64_t parallel_search_prime_3mod4(uint64_t const universe) {
+    if(universe < 3) return 0;
+    return parallel_sieve_prime_predecessor(universe - ((universe - 3ULL) & 3ULL), 4, prime_search_threads().load(std::memory_order_relaxed));
+}
+
+// looks up the prime for the given universe in the prime cache file, which may be corrupt or written by something else
+// a prime is accepted only if it passes the same checks as a prime passed to the constructor of a permutation
+inline bool lookup_valid_prime(DiskPrimeCache const& disk, uint64_t const universe, uint64_t& prime) {
+    if(!disk.lookup(universe, prime)) return false;
+    return (prime == 0) ? universe < 3 : (prime <= universe && (prime & 3) == 3 && is_prime(prime));
+}
+
+/**
+ * \brief Finds the largest prime p less than or equal to the given universe that satisfies p = (3 mod 4) at runtime
+ * 
+ * In contrast to \ref prev_prime_3mod4, this also consults and extends the in-memory prime cache and the prime cache file, if enabled.
+ * 
+ * \param universe the universe
+ * \return the largest prime p less than or equal to the universe that satisfies p = (3 mod 4), or zero if there is none
+ */
+inline uint64_t find_prime_3mod4(uint64_t const universe) {
+    if(auto const* common = find_common_universe(universe)) return common->prime;
+
+    auto& caches = prime_caches();
+    bool const memo = caches.memo_enabled.load(std::memory_order_relaxed);
+    uint64_t p;
+    if(memo && caches.memo.lookup(universe, p)) return p;
+
+    {
+        std::shared_lock lock(caches.mutex);
+        if(!caches.disk) {
+            p = parallel_search_prime_3mod4(universe);
+        } else if(!lookup_valid_prime(*caches.disk, universe, p)) {
+            p = parallel_search_prime_3mod4(universe);
+            caches.disk->insert(universe, p);
+        }
+    }
+
+    if(memo) caches.memo.insert(universe, p);
+    return p;
+}
+
+}
+
+/**
+ * \brief Sets the number of threads used to search primes when constructing permutations
+ * 
+ * Only searches that do not find a prime in the first window of candidates, which is rare, make use of multiple threads.
+ * By default, only the calling thread is used.
+ * 
+ * \param threads the number of threads, or zero to use all hardware threads
+ */
+inline void set_prime_search_threads(unsigned const threads) {
+    internal::prime_search_threads().store(threads ? threads : std::max(1U, std::thread::hardware_concurrency()), std::memory_order_relaxed);
+}
+
+/**
+ * \brief Finds the primes for many universes at once
+ * 
+ * The universes are processed in descending order, so that universes close to each other share prime searches and sieve windows.
+ * Like the construction of a permutation, this consults and extends the in-memory prime cache and the prime cache file, if enabled.
+ * 
+ * \param universes the universes
+ * \return for each universe, the largest prime p less than or equal to it that satisfies p = (3 mod 4), or zero if there is none
+ */
+inline std::vector<uint64_t> find_primes_3mod4(std::span<uint64_t const> const universes) {
+    std::vector<uint64_t> primes(universes.size());
+    std::vector<size_t> order; // the universes that need to be searched
+    order.reserve(universes.size());
+
+    auto& caches = internal::prime_caches();
+    bool const memo = caches.memo_enabled.load(std::memory_order_relaxed);
+    std::shared_lock lock(caches.mutex);
+
+    for(size_t i = 0; i < universes.size(); i++) {
+        uint64_t const u = universes[i];
+        if(auto const* common = internal::find_common_universe(u)) {
+            primes[i] = common->prime;
+        } else if(memo && caches.memo.lookup(u, primes[i])) {
+            // found
+        } else if(caches.disk && internal::lookup_valid_prime(*caches.disk, u, primes[i])) {
+            if(memo) caches.memo.insert(u, primes[i]);
+        } else {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](size_t const a, size_t const b){ return universes[a] > universes[b]; });
+
+    constexpr uint64_t stride = 4;
+    bool have_prev = false;
+    uint64_t prev_prime = 0; // the prime for the previous, greater or equal universe
+    internal::SieveWindow window(0, stride, 0);
+
+    for(size_t const i : order) {
+        uint64_t const u = universes[i];
+        uint64_t const top = (u >= 3) ? u - ((u - 3ULL) & 3ULL) : 0;
+
+        uint64_t p;
+        if(have_prev && prev_prime <= top) {
+            // there is no prime between the previous prime and this universe
+            p = prev_prime;
+        } else if(top <= internal::MAX_SIEVE_PRIME + internal::SIEVE_WINDOW * stride) {
+            p = internal::search_prime_3mod4(u);
+        } else {
+            // continue in the current sieve window if it contains the universe, otherwise start a new one
+            bool const in_window = (window.n > 0 && top <= window.top && top > window.top - window.n * stride);
+            if(!in_window) window = internal::SieveWindow(top, stride, internal::SIEVE_WINDOW);
+            p = window.find((window.top - top) / stride);
+
+            while(!p && window.top - window.n * stride > internal::MAX_SIEVE_PRIME + internal::SIEVE_WINDOW * stride) {
+                window = internal::SieveWindow(window.top - window.n * stride, stride, internal::SIEVE_WINDOW);
+                p = window.find(0);
+            }
+            if(!p) p = internal::sieve_prime_predecessor(window.top - window.n * stride, stride);
+        }
+
+        primes[i] = p;
+        have_prev = true;
+        prev_prime = p;
+
+        if(memo) caches.memo.insert(u, p);
+        if(caches.disk) caches.disk->insert(u, p);
+    }
+    return primes;
+}
+
+}
+
+#endif
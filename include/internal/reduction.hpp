@@ -0,0 +1,362 @@
+/**
+ * internal/reduction.hpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RANDOM_PERMUTATION_REDUCTION_HPP
+#define _RANDOM_PERMUTATION_REDUCTION_HPP
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "math_utils.hpp"
+
+namespace random_permutation {
+
+/**
+ * \brief Computes quadratic residues using the native modulo operator
+ *
+ * This is the straightforward approach, which compiles to a division of the double-width square.
+ * For 64-bit numbers, this is a 128-by-64 bit division.
+ *
+ * \tparam UInt the unsigned integer type of the numbers
+ */
+template<typename UInt>
+class DivisionReduction {
+private:
+    using Wide = internal::wide_t<UInt>;
+
+    UInt prime_;
+
+public:
+    constexpr DivisionReduction() : prime_(0) {}
+
+    /**
+     * \brief Prepares the reduction modulo the given prime
+     *
+     * \param prime the prime
+     */
+    constexpr DivisionReduction(UInt const prime) : prime_(prime) {}
+
+    /**
+     * \brief Computes the square of a number modulo the prime
+     *
+     * \param x the number to square, must be less than the prime
+     * \return the square of x modulo the prime
+     */
+    constexpr UInt square(UInt const x) const {
+        return (Wide(x) * Wide(x)) % Wide(prime_);
+    }
+
+    /**
+     * \brief Returns the prime
+     *
+     * \return the prime
+     */
+    constexpr UInt prime() const { return prime_; }
+};
+
+/**
+ * \brief Computes quadratic residues using Montgomery reduction
+ *
+ * The Montgomery constants are precomputed for the prime, so squaring a number only takes multiplications.
+ * Rather than converting numbers in and out of Montgomery form, the square x^2 is reduced to x^2 * R^-1,
+ * where R = 2^w for the bit width w of the numbers, which is then multiplied by R^2 and reduced again.
+ *
+ * \tparam UInt the unsigned integer type of the numbers
+ */
+template<typename UInt>
+class MontgomeryReduction {
+private:
+    internal::MontgomeryForm<UInt> form_;
+
+public:
+    constexpr MontgomeryReduction() : form_() {}
+
+    /**
+     * \brief Precomputes the Montgomery constants for the given prime
+     *
+     * \param prime the prime, which must be odd
+     */
+    constexpr MontgomeryReduction(UInt const prime) : form_(prime > 0 ? internal::MontgomeryForm<UInt>(prime) : internal::MontgomeryForm<UInt>()) {}
+
+    /**
+     * \brief Restores the reduction from previously computed Montgomery constants
+     *
+     * \param prime the prime
+     * \param inv the inverse of the prime modulo R
+     * \param r2 R^2 modulo the prime
+     */
+    constexpr MontgomeryReduction(UInt const prime, UInt const inv, UInt const r2) : form_(prime, inv, r2) {}
+
+    /**
+     * \brief Computes the square of a number modulo the prime
+     *
+     * \param x the number to square, must be less than the prime
+     * \return the square of x modulo the prime
+     */
+    constexpr UInt square(UInt const x) const {
+        return form_.to(form_.mul(x, x));
+    }
+
+    /**
+     * \brief Returns the inverse of the prime modulo R
+     *
+     * \return the inverse of the prime modulo R
+     */
+    constexpr UInt inverse() const { return form_.inverse(); }
+
+    /**
+     * \brief Returns R^2 modulo the prime
+     *
+     * \return R^2 modulo the prime
+     */
+    constexpr UInt r2() const { return form_.r2(); }
+
+    /**
+     * \brief Returns the prime
+     *
+     * \return the prime
+     */
+    constexpr UInt prime() const { return form_.modulus(); }
+};
+
+/**
+ * \brief Computes quadratic residues using Barrett reduction
+ *
+ * A double-width reciprocal of the prime is precomputed, so squaring a number only takes multiplications.
+ * In contrast to Montgomery reduction, no conversion is needed, which results in a shorter dependency chain.
+ *
+ * \tparam UInt the unsigned integer type of the numbers
+ */
+template<typename UInt>
+class BarrettReduction {
+private:
+    using Wide = internal::wide_t<UInt>;
+    static constexpr unsigned W = std::numeric_limits<UInt>::digits;
+
+    UInt prime_;
+    Wide rcp_; // floor((2^(2w)-1) / prime)
+
+    // computes the upper half of the quadruple-width product of x and the reciprocal
+    constexpr UInt quotient(Wide const x) const {
+        UInt const x0 = x, x1 = x >> W;
+        UInt const r0 = rcp_, r1 = rcp_ >> W;
+        Wide const lo = Wide(x0) * Wide(r0);
+        Wide const m0 = Wide(x0) * Wide(r1);
+        Wide const m1 = Wide(x1) * Wide(r0);
+        Wide const mid = (lo >> W) + UInt(m0) + UInt(m1);
+        return internal::mul_lo(x1, r1) + UInt(m0 >> W) + UInt(m1 >> W) + UInt(mid >> W);
+    }
+
+public:
+    constexpr BarrettReduction() : prime_(0), rcp_(0) {}
+
+    /**
+     * \brief Precomputes the reciprocal of the given prime
+     *
+     * \param prime the prime
+     */
+    constexpr BarrettReduction(UInt const prime) : prime_(prime), rcp_(prime > 0 ? Wide(~Wide(0)) / prime : 0) {}
+
+    /**
+     * \brief Computes the square of a number modulo the prime
+     *
+     * \param x the number to square, must be less than the prime
+     * \return the square of x modulo the prime
+     */
+    constexpr UInt square(UInt const x) const {
+        // the quotient is at most one less than the true quotient
+        Wide const xx = Wide(x) * Wide(x);
+        Wide const r = xx - Wide(quotient(xx)) * Wide(prime_);
+        return r >= prime_ ? r - prime_ : r;
+    }
+
+    /**
+     * \brief Returns the prime
+     *
+     * \return the prime
+     */
+    constexpr UInt prime() const { return prime_; }
+};
+
+/**
+ * \brief Computes quadratic residues modulo pseudo-Mersenne primes
+ *
+ * A pseudo-Mersenne prime has the form p = 2^k - c for a small c.
+ * Since 2^k is congruent to c modulo p, the high bits of a square can be folded onto the low bits
+ * using a multiplication by c, followed by a single conditional subtraction.
+ *
+ * To avoid variable shifts of double-width numbers, everything is scaled by 2^(w-k) for the bit width w of the numbers,
+ * so that the folds take place modulo p * 2^(w-k) = 2^w - c * 2^(w-k) and split the square at the word boundary.
+ * The scaled modulus is derived from the prime when squaring, which costs a count of leading zeros and a shift
+ * that do not depend on the number and are hoisted out of loops.
+ *
+ * \tparam UInt the unsigned integer type of the numbers
+ */
+template<typename UInt>
+class PseudoMersenneReduction {
+private:
+    using Wide = internal::wide_t<UInt>;
+    static constexpr unsigned W = std::numeric_limits<UInt>::digits;
+
+    UInt prime_;
+
+public:
+    /**
+     * \brief Tests whether the given prime is a pseudo-Mersenne prime with a small enough c
+     *
+     * For p = 2^k - c, two folds followed by one subtraction suffice if (c+1)^2 <= 2^k.
+     *
+     * \param prime the prime in question
+     * \return true if the prime has the form 2^k - c and c is small enough, false otherwise
+     */
+    static constexpr bool applicable(UInt const prime) {
+        if(prime == 0) return false;
+
+        unsigned const k = std::bit_width(prime);
+        Wide const c = (Wide(1) << k) - prime;
+        return (c + 1) * (c + 1) <= (Wide(1) << k);
+    }
+
+    constexpr PseudoMersenneReduction() : prime_(0) {}
+
+    /**
+     * \brief Prepares the reduction modulo the given prime
+     *
+     * \param prime the prime, which must satisfy \ref applicable
+     */
+    constexpr PseudoMersenneReduction(UInt const prime) : prime_(prime) {}
+
+    /**
+     * \brief Computes the square of a number modulo the prime
+     *
+     * \param x the number to square, must be less than the prime
+     * \return the square of x modulo the prime
+     */
+    constexpr UInt square(UInt const x) const {
+        unsigned const shift = std::countl_zero(prime_);
+        UInt const modulus = prime_ << shift; // the prime, scaled by 2^shift
+        UInt const c = UInt(0) - modulus;     // 2^w - modulus
+
+        Wide const t = Wide(UInt(x << shift)) * Wide(x);
+        Wide const u = Wide(UInt(t >> W)) * Wide(c) + UInt(t); // less than (c+1) * 2^w
+        UInt const l = u;
+        UInt const v = internal::mul_lo(UInt(u >> W), c) + l; // less than 2 * modulus, possibly overflowing
+        UInt const r = (v < l || v >= modulus) ? v - modulus : v;
+        return r >> shift;
+    }
+
+    /**
+     * \brief Returns the prime
+     *
+     * \return the prime
+     */
+    constexpr UInt prime() const { return prime_; }
+};
+
+/**
+ * \brief Picks the reduction for the prime at construction time
+ *
+ * Pseudo-Mersenne primes, which include all primes for common universes, are reduced using \ref PseudoMersenneReduction.
+ * All other primes are reduced using \ref MontgomeryReduction.
+ *
+ * \tparam UInt the unsigned integer type of the numbers
+ */
+template<typename UInt>
+class AdaptiveReduction {
+private:
+    // the Montgomery constants, where an inverse of zero marks a pseudo-Mersenne prime (the inverse of an odd prime is odd)
+    UInt prime_;
+    UInt inv_;
+    UInt r2_;
+
+public:
+    constexpr AdaptiveReduction() : prime_(0), inv_(0), r2_(0) {}
+
+    /**
+     * \brief Prepares the reduction modulo the given prime
+     *
+     * \param prime the prime
+     */
+    constexpr AdaptiveReduction(UInt const prime) : prime_(prime), inv_(0), r2_(0) {
+        if(!PseudoMersenneReduction<UInt>::applicable(prime)) {
+            MontgomeryReduction<UInt> const mont(prime);
+            inv_ = mont.inverse();
+            r2_ = mont.r2();
+        }
+    }
+
+    /**
+     * \brief Computes the square of a number modulo the prime
+     *
+     * \param x the number to square, must be less than the prime
+     * \return the square of x modulo the prime
+     */
+    constexpr UInt square(UInt const x) const {
+        return inv_ ? MontgomeryReduction<UInt>(prime_, inv_, r2_).square(x) : PseudoMersenneReduction<UInt>(prime_).square(x);
+    }
+
+    /**
+     * \brief Returns the prime
+     *
+     * \return the prime
+     */
+    constexpr UInt prime() const { return prime_; }
+};
+
+namespace internal {
+
+// compile-time properties of the supported widths
+template<typename UInt> struct width_traits;
+
+// constant_reduction is used if the prime is known at compile time
+template<> struct width_traits<uint16_t> {
+    // squares fit into 32 bits, for which a hardware division is cheap
+    template<typename U> using default_reduction = DivisionReduction<U>;
+    template<typename U> using constant_reduction = DivisionReduction<U>;
+};
+
+template<> struct width_traits<uint32_t> {
+    template<typename U> using default_reduction = AdaptiveReduction<U>;
+
+    // the compiler replaces the division by a constant by a multiplication
+    template<typename U> using constant_reduction = DivisionReduction<U>;
+};
+
+template<> struct width_traits<uint64_t> {
+    template<typename U> using default_reduction = AdaptiveReduction<U>;
+
+    // 128-bit divisions by a constant are not replaced, but the adaptive choice is resolved at compile time
+    template<typename U> using constant_reduction = AdaptiveReduction<U>;
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,229 @@
+/**
+ * internal/simd.hpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RANDOM_PERMUTATION_SIMD_HPP
+#define _RANDOM_PERMUTATION_SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu.hpp"
+
+#ifdef RANDOM_PERMUTATION_X86_64
+#include <immintrin.h>
+#endif
+
+namespace random_permutation::internal {
+
+// the state of a permutation needed by the batch kernels, including Montgomery constants for the prime
+template<typename UInt>
+struct BatchParams {
+    UInt universe;
+    UInt prime;
+    UInt seed_lo;
+    UInt seed_hi;
+    UInt wrap;
+    UInt inv;
+    UInt r2;
+};
+
+#ifdef RANDOM_PERMUTATION_X86_64
+
+// 32-bit numbers are kept in 64-bit lanes, so products fit
+struct Avx2Kernel32 {
+    __m256i universe, prime, half, seed_lo, seed_hi, wrap, inv, r2;
+
+    RANDOM_PERMUTATION_TARGET_V3 inline Avx2Kernel32(BatchParams<uint32_t> const& params)
+        : universe(_mm256_set1_epi64x(params.universe)),
+          prime(_mm256_set1_epi64x(params.prime)),
+          half(_mm256_set1_epi64x(params.prime >> 1)),
+          seed_lo(_mm256_set1_epi64x(params.seed_lo)),
+          seed_hi(_mm256_set1_epi64x(params.seed_hi)),
+          wrap(_mm256_set1_epi64x(params.wrap)),
+          inv(_mm256_set1_epi64x(params.inv)),
+          r2(_mm256_set1_epi64x(params.r2)) {
+    }
+
+    // computes t * 2^-32 modulo the prime for t < prime * 2^32
+    RANDOM_PERMUTATION_TARGET_V3 inline __m256i redc(__m256i const t) const {
+        __m256i const m = _mm256_mul_epu32(t, inv); // only the low 32 bits matter
+        __m256i const mp = _mm256_srli_epi64(_mm256_mul_epu32(m, prime), 32);
+        __m256i const th = _mm256_srli_epi64(t, 32);
+        __m256i const r = _mm256_sub_epi64(th, mp);
+        return _mm256_add_epi64(r, _mm256_and_si256(prime, _mm256_cmpgt_epi64(mp, th)));
+    }
+
+    RANDOM_PERMUTATION_TARGET_V3 inline __m256i permute(__m256i const x) const {
+        __m256i const sq = redc(_mm256_mul_epu32(redc(_mm256_mul_epu32(x, x)), r2));
+        __m256i const r = _mm256_blendv_epi8(sq, _mm256_sub_epi64(prime, sq), _mm256_cmpgt_epi64(x, half));
+
+        // numbers in the gap are mapped to themselves
+        return _mm256_blendv_epi8(x, r, _mm256_cmpgt_epi64(prime, x));
+    }
+
+    RANDOM_PERMUTATION_TARGET_V3 inline __m256i offset(__m256i const x) const {
+        __m256i const s = _mm256_blendv_epi8(seed_hi, seed_lo, _mm256_cmpgt_epi64(wrap, x));
+        __m256i const y = _mm256_add_epi64(s, x);
+        return _mm256_sub_epi64(y, _mm256_andnot_si256(_mm256_cmpgt_epi64(universe, y), universe));
+    }
+
+    RANDOM_PERMUTATION_TARGET_V3 inline __m256i operator()(__m256i const i) const { return permute(offset(permute(i))); }
+};
+
+/**
+ * \brief Computes consecutive numbers of a 32-bit permutation, eight at a time using AVX2
+ * 
+ * Only numbers within the universe are processed, the remainder is left to the caller.
+ * 
+ * \param params the state of the permutation
+ * \param first the number to start from
+ * \param out the output array
+ * \param n the number of numbers to compute
+ * \return the number of numbers that have been computed
+ */
+RANDOM_PERMUTATION_TARGET_V3 inline size_t fill_avx2(BatchParams<uint32_t> const& params, uint32_t const first, uint32_t* out, size_t n) {
+    if(first >= params.universe) return 0;
+    if(n > params.universe - first) n = params.universe - first;
+
+    Avx2Kernel32 const kernel(params);
+    __m256i const pack = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m256i const step = _mm256_set1_epi64x(8);
+    __m256i lo = _mm256_add_epi64(_mm256_set1_epi64x(first), _mm256_setr_epi64x(0, 1, 2, 3));
+    __m256i hi = _mm256_add_epi64(_mm256_set1_epi64x(first), _mm256_setr_epi64x(4, 5, 6, 7));
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i const a = _mm256_permutevar8x32_epi32(kernel(lo), pack);
+        __m256i const b = _mm256_permutevar8x32_epi32(kernel(hi), pack);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_blend_epi32(a, b, 0xF0));
+
+        lo = _mm256_add_epi64(lo, step);
+        hi = _mm256_add_epi64(hi, step);
+    }
+    return i;
+}
+
+
+// 64-bit numbers in 64-bit lanes, full products are assembled from 32-bit partial products
+struct Avx512Kernel64 {
+    __m512i universe, prime, half, seed_lo, seed_hi, wrap, inv, r2;
+
+    RANDOM_PERMUTATION_TARGET_V4 inline Avx512Kernel64(BatchParams<uint64_t> const& params)
+        : universe(_mm512_set1_epi64(params.universe)),
+          prime(_mm512_set1_epi64(params.prime)),
+          half(_mm512_set1_epi64(params.prime >> 1)),
+          seed_lo(_mm512_set1_epi64(params.seed_lo)),
+          seed_hi(_mm512_set1_epi64(params.seed_hi)),
+          wrap(_mm512_set1_epi64(params.wrap)),
+          inv(_mm512_set1_epi64(params.inv)),
+          r2(_mm512_set1_epi64(params.r2)) {
+    }
+
+    // the plain shifts and multiplication leave an undefined vector for the unused mask,
+    // which GCC reports as maybe uninitialized (bug 105593), so all lanes are selected explicitly
+    RANDOM_PERMUTATION_TARGET_V4 static inline __m512i srli(__m512i const x, unsigned const k) { return _mm512_maskz_srli_epi64(0xFF, x, k); }
+    RANDOM_PERMUTATION_TARGET_V4 static inline __m512i slli(__m512i const x, unsigned const k) { return _mm512_maskz_slli_epi64(0xFF, x, k); }
+    RANDOM_PERMUTATION_TARGET_V4 static inline __m512i mul32(__m512i const a, __m512i const b) { return _mm512_maskz_mul_epu32(0xFF, a, b); }
+
+    // computes the 128-bit products of a and b
+    RANDOM_PERMUTATION_TARGET_V4 static inline void mul(__m512i const a, __m512i const b, __m512i& lo, __m512i& hi) {
+        __m512i const lo32 = _mm512_set1_epi64(0xFFFFFFFFULL);
+        __m512i const ah = srli(a, 32);
+        __m512i const bh = srli(b, 32);
+
+        __m512i const ll = mul32(a, b);
+        __m512i const lh = mul32(a, bh);
+        __m512i const hl = mul32(ah, b);
+        __m512i const hh = mul32(ah, bh);
+
+        // less than 3 * 2^32, so no overflow
+        __m512i const mid = _mm512_add_epi64(srli(ll, 32), _mm512_add_epi64(_mm512_and_si512(lh, lo32), _mm512_and_si512(hl, lo32)));
+        lo = _mm512_or_si512(slli(mid, 32), _mm512_and_si512(ll, lo32));
+        hi = _mm512_add_epi64(_mm512_add_epi64(hh, srli(mid, 32)), _mm512_add_epi64(srli(lh, 32), srli(hl, 32)));
+    }
+
+    // computes (hi * 2^64 + lo) * 2^-64 modulo the prime for hi < prime
+    RANDOM_PERMUTATION_TARGET_V4 inline __m512i redc(__m512i const lo, __m512i const hi) const {
+        __m512i mlo, mhi;
+        mul(_mm512_mullo_epi64(lo, inv), prime, mlo, mhi);
+        __m512i const r = _mm512_sub_epi64(hi, mhi);
+        return _mm512_mask_add_epi64(r, _mm512_cmplt_epu64_mask(hi, mhi), r, prime);
+    }
+
+    RANDOM_PERMUTATION_TARGET_V4 inline __m512i permute(__m512i const x) const {
+        __m512i lo, hi;
+        mul(x, x, lo, hi);
+        mul(redc(lo, hi), r2, lo, hi);
+        __m512i const sq = redc(lo, hi);
+        __m512i const r = _mm512_mask_sub_epi64(sq, _mm512_cmpgt_epu64_mask(x, half), prime, sq);
+
+        // numbers in the gap are mapped to themselves
+        return _mm512_mask_blend_epi64(_mm512_cmplt_epu64_mask(x, prime), x, r);
+    }
+
+    RANDOM_PERMUTATION_TARGET_V4 inline __m512i offset(__m512i const x) const {
+        __m512i const s = _mm512_mask_blend_epi64(_mm512_cmplt_epu64_mask(x, wrap), seed_hi, seed_lo);
+        __m512i const y = _mm512_add_epi64(s, x);
+        __mmask8 const sub = _mm512_cmplt_epu64_mask(y, s) | _mm512_cmpge_epu64_mask(y, universe);
+        return _mm512_mask_sub_epi64(y, sub, y, universe);
+    }
+
+    RANDOM_PERMUTATION_TARGET_V4 inline __m512i operator()(__m512i const i) const { return permute(offset(permute(i))); }
+};
+
+/**
+ * \brief Computes consecutive numbers of a 64-bit permutation, eight at a time using AVX-512
+ * 
+ * Only numbers within the universe are processed, the remainder is left to the caller.
+ * 
+ * \param params the state of the permutation
+ * \param first the number to start from
+ * \param out the output array
+ * \param n the number of numbers to compute
+ * \return the number of numbers that have been computed
+ */
+RANDOM_PERMUTATION_TARGET_V4 inline size_t fill_avx512(BatchParams<uint64_t> const& params, uint64_t const first, uint64_t* out, size_t n) {
+    if(first >= params.universe) return 0;
+    if(n > params.universe - first) n = params.universe - first;
+
+    Avx512Kernel64 const kernel(params);
+    __m512i const step = _mm512_set1_epi64(8);
+    __m512i x = _mm512_add_epi64(_mm512_set1_epi64(first), _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm512_storeu_si512(out + i, kernel(x));
+        x = _mm512_add_epi64(x, step);
+    }
+    return i;
+}
+
+#endif
+
+}
+
+#endif
@@ -28,11 +28,31 @@
 #ifndef _RANDOM_PERMUTATION_HPP
 #define _RANDOM_PERMUTATION_HPP
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <chrono>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <future>
 #include <iterator>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
+#include "internal/cpu.hpp"
 #include "internal/math_utils.hpp"
+#include "internal/parallel.hpp"
+#include "internal/prime_cache.hpp"
+#include "internal/prime_search.hpp"
+#include "internal/reduction.hpp"
+#include "internal/simd.hpp"
 
 namespace random_permutation {
 
@@ -45,141 +65,671 @@ using namespace internal;
  */
 inline uint64_t timestamp() { return std::chrono::high_resolution_clock::now().time_since_epoch().count(); }
 
+template<typename Perm> class BufferedView;
+
 /**
  * \brief Generates a random permutation of positive numbers from a universe of given size with near-uniform distribution
  * 
  * This is based on an article by Jeff Preshing (https://preshing.com/20121224/how-to-generate-a-sequence-of-unique-random-integers),
  * who describes how to generate random permutations of 32-bit numbers using quadratic residues of primes.
  * It has been modified to support an arbitrary universe size up to 2^64-1.
+ * 
+ * For the same universe and seed, all widths produce the same permutation.
+ * Narrower widths restrict the universe, but keep all arithmetic within double their width.
+ * 
+ * \tparam UInt the unsigned integer type of the numbers, either \c uint16_t, \c uint32_t or \c uint64_t
+ * \tparam Reduction the policy used to compute quadratic residues modulo the prime, the default depends on the width
  */
-class RandomPermutation {
+template<std::unsigned_integral UInt, template<typename> typename Reduction = internal::width_traits<UInt>::template default_reduction>
+class BasicRandomPermutation : public std::ranges::view_interface<BasicRandomPermutation<UInt, Reduction>> {
 private:
-    // some common universe sizes and the corresponding primes that satisfy (3 mod 4)
-    struct CommonUniverse { uint64_t universe, prime; };
-    static constexpr CommonUniverse common_universes[] = {
-        { pow2(16) - 2, pow2(16) - 17 },
-        { pow2(16) - 1, pow2(16) - 17 },
-        { pow2(24) - 2, pow2(24) - 17 },
-        { pow2(24) - 1, pow2(24) - 17 },
-        { pow2(32) - 2, pow2(32) - 5 },
-        { pow2(32) - 1, pow2(32) - 5 },
-        { pow2(40) - 2, pow2(40) - 213 },
-        { pow2(40) - 1, pow2(40) - 213 },
-        { pow2(48) - 2, pow2(48) - 65 },
-        { pow2(48) - 1, pow2(48) - 65 },
-        { pow2(56) - 2, pow2(56) - 5 },
-        { pow2(56) - 1, pow2(56) - 5 },
-        { pow2(63) - 2, pow2(63) - 25 },
-        { pow2(63) - 1, pow2(63) - 25 },
-        { UINT64_MAX-1, 0xFFFFFFFFFFFFFF43ULL },
-        { UINT64_MAX,   0xFFFFFFFFFFFFFF43ULL },
-        { 0, 0 }
-    };
+    static constexpr UInt UINT_MAX_ = std::numeric_limits<UInt>::max();
 
     // provides a decent distribution of 64 bits
     static constexpr uint64_t SHUFFLE1 = 0x9696594B6A5936B2ULL;
     static constexpr uint64_t SHUFFLE2 = 0xD2165B4B66592AD6ULL;
 
-    // finds the largest prime p less than or equal to x that satisfies p = (3 mod 4)
-    static inline uint64_t prev_prime_3mod4(uint64_t const universe) {
-        // test if universe is common
-        for(unsigned i = 0; common_universes[i].prime > 0; i++) {
-            if(universe == common_universes[i].universe) {
-                return common_universes[i].prime;
-            }
-        }
-        
-        // otherwise, do it the hard way
-        uint64_t p = prime_predecessor(universe);
-        while((p & 3ULL) != 3ULL) {
-            p = prime_predecessor(p - 1);
-        }
-        return p;
-    }
-
-    // members
-    uint64_t universe_;
+    // members - the prime is kept by the reduction
     uint64_t seed_;
-    uint64_t prime_;
+    UInt universe_;
+    UInt seed_lo_; // seed_ mod universe_, precomputed for offsetting by the seed without division
+    Reduction<UInt> reduction_;
 
     // permute the given number
-    inline uint64_t permute(uint64_t const x) const {
-        if(x >= prime_) {
+    constexpr UInt permute(UInt const x) const {
+        UInt const p = reduction_.prime();
+        if(x >= p) {
             // map numbers in gap to themselves - shuffling will take care of this
             return x;
         } else {
             // use quadratic residue
-            const uint64_t r = ((__uint128_t)x * (__uint128_t)x) % (__uint128_t)prime_;
-            return (x <= (prime_ >> 1ULL)) ? r : prime_ - r;
+            const UInt r = reduction_.square(x);
+            return (x <= (p >> 1)) ? r : p - r;
+        }
+    }
+
+    // offset the given number by the seed, equivalent to (seed_ + x) % universe_ in 64-bit arithmetic
+    constexpr UInt offset(UInt const x) const {
+        if(x >= universe_)[[unlikely]] {
+            // only possible for numbers outside of the universe
+            return (seed_ + x) % universe_;
+        } else {
+            // if adding the seed overflows, the truncated sum is less than x and thus already in the universe
+            const uint64_t t = seed_ + x;
+
+            // otherwise, both summands are less than universe_, so one subtraction is enough
+            const UInt y = seed_lo_ + x;
+            const UInt z = y - (universe_ & (UInt(0) - UInt((y < seed_lo_) | (y >= universe_))));
+            return (t < seed_) ? UInt(t) : z;
+        }
+    }
+
+    // arithmetic modulo the prime for inverting permute, which is never needed if the prime is zero
+    constexpr MontgomeryForm<uint64_t> prime_form() const { return MontgomeryForm<uint64_t>(prime() ? prime() : 1); }
+
+    // inverts permute for several numbers at once, which share the exponentiation's sequence of operations
+    // since the prime p = 3 (mod 4), z^((p+1)/4) is a square root of z if z is a quadratic residue, and of p-z otherwise
+    template<size_t N>
+    constexpr void unpermute(MontgomeryForm<uint64_t> const& mf, UInt (&z)[N]) const {
+        UInt const p = prime();
+        uint64_t zm[N], b[N], r[N];
+        for(size_t j = 0; j < N; j++) {
+            zm[j] = mf.to(z[j] < p ? z[j] : 0);
+            b[j] = zm[j];
+            r[j] = mf.to(1);
+        }
+        for(uint64_t e = (uint64_t(p) >> 2) + 1; e; e >>= 1) {
+            if(e & 1) for(size_t j = 0; j < N; j++) r[j] = mf.mul(r[j], b[j]);
+            for(size_t j = 0; j < N; j++) b[j] = mf.mul(b[j], b[j]);
+        }
+        for(size_t j = 0; j < N; j++) {
+            if(z[j] < p) {
+                // the residue of the smaller square root is kept, that of the larger one is reflected
+                UInt const s = UInt(mf.from(r[j]));
+                UInt const t = p - s;
+                z[j] = (mf.mul(r[j], r[j]) == zm[j]) ? std::min(s, t) : std::max(s, t);
+            }
+        }
+    }
+
+    // inverts offset for numbers within the universe
+    constexpr UInt unoffset(UInt const y) const {
+        // if adding the seed may overflow, both candidates can be valid and either of them is a preimage
+        UInt const x = (y >= seed_lo_) ? y - seed_lo_ : y + (universe_ - seed_lo_);
+        if(uint64_t(seed_ + x) >= seed_) return x;
+        return UInt(y - seed_);
+    }
+
+    // number of numbers inverted at once by the batch inverse, whose modular exponentiations share their loop
+    static constexpr size_t INVERSE_LANES = 4;
+
+    // inverts the permutation for several numbers at once
+    template<size_t N>
+    constexpr void invert(MontgomeryForm<uint64_t> const& mf, UInt (&y)[N]) const {
+        unpermute(mf, y);
+        for(size_t j = 0; j < N; j++) y[j] = unoffset(y[j]);
+        unpermute(mf, y);
+    }
+
+    // gathers the state needed by the batch kernels
+    inline BatchParams<UInt> batch_params() const {
+        MontgomeryReduction<UInt> const mont(prime());
+
+        // (seed_ - 2^64) mod universe_, used if adding the seed overflows, which happens from the wrap on
+        UInt const w = (UINT64_MAX % universe_ + 1ULL) % universe_; // 2^64 mod universe_
+        UInt const seed_hi = (seed_lo_ >= w) ? seed_lo_ - w : seed_lo_ + (universe_ - w);
+
+        // numbers in the universe are less than UINT_MAX_, so capping does no harm
+        uint64_t const wrap = 0ULL - seed_;
+        return { universe_, prime(), seed_lo_, seed_hi, (seed_ > 0 && wrap < UINT_MAX_) ? UInt(wrap) : UINT_MAX_, mont.inverse(), mont.r2() };
+    }
+
+    // tests whether the reduction folds by a pseudo-Mersenne prime
+    // the scalar kernel is then as fast as the AVX-512 kernel, which always uses Montgomery multiplications
+    constexpr bool folds_pseudo_mersenne() const {
+        if constexpr(std::is_same_v<Reduction<UInt>, PseudoMersenneReduction<UInt>>) {
+            return true;
+        } else if constexpr(std::is_same_v<Reduction<UInt>, AdaptiveReduction<UInt>>) {
+            return PseudoMersenneReduction<UInt>::applicable(prime());
+        } else {
+            return false;
+        }
+    }
+
+    // computes the numbers of the permutation starting at the given offset of the output
+    // the permutation is passed by value so that its state stays in registers instead of being reloaded after every store
+    static inline void fill_scalar(BasicRandomPermutation const self, UInt const first, UInt* const out, size_t i, size_t const n) {
+        for(; i < n; i++) {
+            out[i] = self(UInt(first + i));
+        }
+    }
+
+#if defined(RANDOM_PERMUTATION_X86_64) && !defined(__AVX2__)
+    // same as fill_scalar, but allowed to use BMI2 (mulx, shlx) if the build does not already
+    RANDOM_PERMUTATION_TARGET_V3 static void fill_scalar_v3(BasicRandomPermutation const self, UInt const first, UInt* const out, size_t const i, size_t const n) {
+        fill_scalar(self, first, out, i, n);
+    }
+#endif
+
+    // number of numbers computed at a time when filling an output of a different width
+    static constexpr size_t CONVERSION_BUFFER = 256;
+
+    // computes consecutive numbers of the permutation into an output of a different width via a buffer
+    template<std::unsigned_integral Out>
+    void fill_converted(UInt const first, std::span<Out> out) const {
+        if constexpr(sizeof(Out) < sizeof(UInt)) {
+            if(universe_ - 1 > std::numeric_limits<Out>::max()) throw std::invalid_argument("the universe exceeds the width of the output");
+        }
+
+        UInt buffer[CONVERSION_BUFFER];
+        for(size_t i = 0; i < out.size(); i += CONVERSION_BUFFER) {
+            size_t const n = std::min(CONVERSION_BUFFER, out.size() - i);
+            fill(UInt(first + i), std::span<UInt>(buffer, n));
+            for(size_t j = 0; j < n; j++) out[i + j] = Out(buffer[j]);
+        }
+    }
+
+    struct TrustedPrime {};
+
+    constexpr BasicRandomPermutation(UInt const universe, uint64_t const seed, UInt const prime, TrustedPrime)
+        : seed_((seed ^ SHUFFLE1) ^ SHUFFLE2),
+          universe_(universe),
+          seed_lo_(seed_ % universe_),
+          reduction_(prime) {
+    }
+
+    // checks that the universe fits into UInt
+    static constexpr UInt validate_universe(uint64_t const universe) {
+        if(universe == 0) throw std::invalid_argument("the universe must not be empty");
+        if(universe > UINT_MAX_) throw std::invalid_argument("the universe exceeds the width of the permutation");
+        return UInt(universe);
+    }
+
+    // checks that the prime is suitable for the universe
+    static constexpr UInt validate_prime(uint64_t const universe, uint64_t const prime) {
+        if(prime == 0 ? universe >= 3 : (prime > universe || (prime & 3) != 3 || !is_prime(prime))) {
+            throw std::invalid_argument("the prime is not a prime p <= universe that satisfies p = (3 mod 4)");
         }
+        return UInt(prime);
+    }
+
+    struct ValidUniverse {};
+
+    constexpr BasicRandomPermutation(UInt const universe, uint64_t const seed, ValidUniverse)
+        : BasicRandomPermutation(universe, seed, UInt(std::is_constant_evaluated() ? prev_prime_3mod4(universe) : find_prime_3mod4(universe)), TrustedPrime{}) {
     }
 
+public:
+    /**
+     * \brief The size of the binary form of a permutation in bytes
+     */
+    static constexpr size_t BLOB_SIZE = 24;
+
+private:
+    // random access iterator over the positions 0, 1, ..., universe
+    // positions are stored in a wider type so that the end position and distances fit even for the largest universe
     class Iterator {
+    public:
+        using iterator_concept  = std::random_access_iterator_tag;
+        using iterator_category = std::random_access_iterator_tag;
+        using difference_type   = std::conditional_t<(std::numeric_limits<UInt>::digits < 64), int64_t, __int128_t>;
+        using value_type        = UInt;
+        using pointer           = void;
+        using reference         = UInt;
+
     private:
-        RandomPermutation const* perm_;
-        uint64_t x_;
-        bool overflow_;
+        BasicRandomPermutation const* perm_;
+        difference_type i_;
 
     public:
-        using iterator_category = std::input_iterator_tag;
-        using difference_type   = std::ptrdiff_t;
-        using value_type        = uint64_t;
-        using pointer           = uint64_t*;
-        using reference         = uint64_t&;
-
-        Iterator(RandomPermutation const& perm, uint64_t const x) : perm_(&perm), x_(x), overflow_(x_ > perm.universe_) {}
-        Iterator(RandomPermutation const& perm, uint64_t const x, bool const overflow) : perm_(&perm), x_(x), overflow_(overflow) {}
+        constexpr Iterator() : perm_(nullptr), i_(0) {}
+        constexpr Iterator(BasicRandomPermutation const& perm, difference_type const i) : perm_(&perm), i_(i) {}
 
         Iterator(Iterator const&) = default;
         Iterator(Iterator&&) = default;
         Iterator& operator=(Iterator const&) = default;
         Iterator& operator=(Iterator&&) = default;
 
-        bool operator==(Iterator const&) const = default;
-        bool operator!=(Iterator const&) const = default;
+        constexpr bool operator==(Iterator const& other) const { return i_ == other.i_; }
+        constexpr auto operator<=>(Iterator const& other) const { return i_ <=> other.i_; }
+
+        inline constexpr UInt operator*() const { return (*perm_)(UInt(i_)); }
+        inline constexpr UInt operator[](difference_type const n) const { return (*perm_)(UInt(i_ + n)); }
 
-        inline uint64_t operator*() const { return (*perm_)(x_); }
-        inline Iterator& operator++() { overflow_ = (x_ == perm_->universe_);  ++x_; return *this; }
-        inline Iterator operator++(int) { Iterator copy = *this; ++*this; return copy; }
+        inline constexpr Iterator& operator++() { ++i_; return *this; }
+        inline constexpr Iterator operator++(int) { Iterator copy = *this; ++i_; return copy; }
+        inline constexpr Iterator& operator--() { --i_; return *this; }
+        inline constexpr Iterator operator--(int) { Iterator copy = *this; --i_; return copy; }
+
+        inline constexpr Iterator& operator+=(difference_type const n) { i_ += n; return *this; }
+        inline constexpr Iterator& operator-=(difference_type const n) { i_ -= n; return *this; }
+        inline constexpr Iterator operator+(difference_type const n) const { return Iterator(*perm_, i_ + n); }
+        inline constexpr Iterator operator-(difference_type const n) const { return Iterator(*perm_, i_ - n); }
+        inline constexpr difference_type operator-(Iterator const& other) const { return i_ - other.i_; }
+        friend inline constexpr Iterator operator+(difference_type const n, Iterator const& it) { return it + n; }
     };
 
 public:
+    using value_type = UInt;
+
     /**
      * \brief Initializes an empty permutation that contains only zero
      */
-    inline RandomPermutation() : universe_(1), seed_(0), prime_(0) {}
+    constexpr BasicRandomPermutation() : seed_(0), universe_(1), seed_lo_(0), reduction_() {}
     
-    RandomPermutation(RandomPermutation const&) = default;
-    RandomPermutation(RandomPermutation&&) = default;
-    RandomPermutation& operator=(RandomPermutation const&) = default;
-    RandomPermutation& operator=(RandomPermutation&&) = default;
+    BasicRandomPermutation(BasicRandomPermutation const&) = default;
+    BasicRandomPermutation(BasicRandomPermutation&&) = default;
+    BasicRandomPermutation& operator=(BasicRandomPermutation const&) = default;
+    BasicRandomPermutation& operator=(BasicRandomPermutation&&) = default;
 
     /**
      * \brief Initializes a permutation with a given random seed
      * 
      * \param universe the size of the universe
      * \param seed the random seed
+     * \throws std::invalid_argument if the universe is empty or exceeds the width of the permutation
+     */
+    constexpr BasicRandomPermutation(uint64_t const universe, uint64_t const seed = timestamp())
+        : BasicRandomPermutation(validate_universe(universe), seed, ValidUniverse{}) {
+    }
+
+    /**
+     * \brief Initializes a permutation with a given random seed and a known prime, skipping the prime search
+     * 
+     * The prime is validated by a primality test, but it is not verified that it is the largest suitable prime.
+     * A smaller prime still yields a permutation, albeit a different one than that constructed without a prime.
+     * 
+     * \param universe the size of the universe
+     * \param seed the random seed
+     * \param prime the largest prime p less than or equal to the universe that satisfies p = (3 mod 4), or zero if there is none
+     * \throws std::invalid_argument if the universe is empty or exceeds the width of the permutation, or if the prime is invalid
+     */
+    constexpr BasicRandomPermutation(uint64_t const universe, uint64_t const seed, uint64_t const prime)
+        : BasicRandomPermutation(validate_universe(universe), seed, validate_prime(universe, prime), TrustedPrime{}) {
+    }
+
+    /**
+     * \brief Constructs a permutation in the background
+     * 
+     * The prime search runs on a separate thread, so it can overlap with other initialization.
+     * 
+     * \param universe the size of the universe
+     * \param seed the random seed
+     * \return a future that holds the permutation once it has been constructed, or the exception thrown by the constructor
+     */
+    static std::future<BasicRandomPermutation> make_async(uint64_t const universe, uint64_t const seed = timestamp()) {
+        return std::async(std::launch::async, [universe, seed](){ return BasicRandomPermutation(universe, seed); });
+    }
+
+    /**
+     * \brief Computes the i-th number of the permutation
+     * 
+     * \param i the number to permute
+     * \return the permuted number
+     */
+    constexpr UInt operator()(UInt const i) const { return permute(offset(permute(i))); }
+
+    /**
+     * \brief Computes the position of a number in the permutation
+     * 
+     * This inverts the permutation using a modular exponentiation, i.e., in logarithmic time.
+     * If the random offset overflows 64 bits, some seeds map two positions to the same number;
+     * in that case, either of them is returned, and numbers that do not occur have no meaningful position.
+     * 
+     * \param y the permuted number, which must be less than the universe
+     * \return the number i for which the i-th number of the permutation is y
+     */
+    constexpr UInt inverse(UInt const y) const {
+        UInt x[1] = { y };
+        invert(prime_form(), x);
+        return x[0];
+    }
+
+    /**
+     * \brief Computes the positions of many numbers in the permutation
+     * 
+     * This evaluates several numbers at once, sharing the modular exponentiations' sequence of operations.
+     * 
+     * \param in the permuted numbers, which must be less than the universe
+     * \param out the output, which receives the positions of the numbers and may be the same as the input
+     */
+    void inverse(std::span<UInt const> const in, std::span<UInt> const out) const {
+        MontgomeryForm<uint64_t> const mf = prime_form();
+        size_t const n = std::min(in.size(), out.size());
+        size_t i = 0;
+        for(; i + INVERSE_LANES <= n; i += INVERSE_LANES) {
+            UInt x[INVERSE_LANES];
+            for(size_t j = 0; j < INVERSE_LANES; j++) x[j] = in[i + j];
+            invert(mf, x);
+            for(size_t j = 0; j < INVERSE_LANES; j++) out[i + j] = x[j];
+        }
+        for(; i < n; i++) {
+            UInt x[1] = { in[i] };
+            invert(mf, x);
+            out[i] = x[0];
+        }
+    }
+
+    /**
+     * \brief Computes consecutive numbers of the permutation
+     * 
+     * This evaluates eight numbers at once using AVX2 for 32-bit numbers or AVX-512 for 64-bit numbers,
+     * if the CPU supports it (see \ref isa_level), except for 64-bit numbers if the reduction folds by a pseudo-Mersenne prime.
+     * Otherwise, the numbers are computed one after another.
+     * 
+     * \param first the number to start from
+     * \param out the output, which receives the permuted numbers of first, first+1, ..., first+out.size()-1
+     */
+    void fill(UInt const first, std::span<UInt> out) const {
+        size_t i = 0;
+#ifdef RANDOM_PERMUTATION_X86_64
+        IsaLevel const isa = isa_level();
+        if constexpr(std::is_same_v<UInt, uint32_t>) {
+            if(isa >= IsaLevel::x86_64_v3) i = fill_avx2(batch_params(), first, out.data(), out.size());
+        } else if constexpr(std::is_same_v<UInt, uint64_t>) {
+            if(isa >= IsaLevel::x86_64_v4 && !folds_pseudo_mersenne()) i = fill_avx512(batch_params(), first, out.data(), out.size());
+        }
+#ifndef __AVX2__
+        if(isa >= IsaLevel::x86_64_v3) {
+            fill_scalar_v3(*this, first, out.data(), i, out.size());
+            return;
+        }
+#endif
+#endif
+        fill_scalar(*this, first, out.data(), i, out.size());
+    }
+
+    /**
+     * \brief Computes consecutive numbers of the permutation into a 64-bit output
+     * 
+     * \param first the number to start from
+     * \param out the output, which receives the permuted numbers of first, first+1, ..., first+out.size()-1
+     */
+    void fill(UInt const first, std::span<uint64_t> out) const requires(!std::is_same_v<UInt, uint64_t>) { fill_converted(first, out); }
+
+    /**
+     * \brief Computes consecutive numbers of the permutation into a 32-bit output
+     * 
+     * \param first the number to start from
+     * \param out the output, which receives the permuted numbers of first, first+1, ..., first+out.size()-1
+     * \throws std::invalid_argument if the universe exceeds 2^32
+     */
+    void fill(UInt const first, std::span<uint32_t> out) const requires(!std::is_same_v<UInt, uint32_t>) { fill_converted(first, out); }
+
+    /**
+     * \brief Returns the size of the universe
+     * 
+     * \return the size of the universe
      */
-    RandomPermutation(uint64_t const universe, uint64_t const seed = timestamp())
-        : universe_(universe),
-          prime_(prev_prime_3mod4(universe)),
-          seed_((seed ^ SHUFFLE1) ^ SHUFFLE2) {
+    constexpr UInt universe() const { return universe_; }
+
+    /**
+     * \brief Returns the random seed
+     * 
+     * \return the random seed
+     */
+    constexpr uint64_t seed() const { return (seed_ ^ SHUFFLE2) ^ SHUFFLE1; }
+
+    /**
+     * \brief Returns the prime used for the quadratic residues
+     * 
+     * \return the prime, or zero if the universe is too small
+     */
+    constexpr UInt prime() const { return reduction_.prime(); }
+
+    /**
+     * \brief Serializes the permutation into a compact binary form
+     * 
+     * The blob consists of the universe, the seed and the prime as 64-bit little endian numbers,
+     * so it can be deserialized for any width that fits the universe.
+     * 
+     * \return the binary form
+     */
+    std::array<std::byte, BLOB_SIZE> serialize() const {
+        std::array<std::byte, BLOB_SIZE> blob;
+        uint64_t const fields[] = { universe_, seed(), prime() };
+        for(size_t i = 0; i < BLOB_SIZE; i++) blob[i] = std::byte(fields[i / 8] >> ((i % 8) * 8));
+        return blob;
+    }
+
+    /**
+     * \brief Restores a permutation from its binary form without searching the prime
+     * 
+     * \param blob the binary form as obtained by \ref serialize
+     * \return the permutation
+     * \throws std::invalid_argument if the blob does not describe a valid permutation of this width
+     */
+    static BasicRandomPermutation deserialize(std::span<std::byte const, BLOB_SIZE> const blob) {
+        uint64_t fields[3] = { 0, 0, 0 };
+        for(size_t i = 0; i < BLOB_SIZE; i++) fields[i / 8] |= uint64_t(blob[i]) << ((i % 8) * 8);
+        return BasicRandomPermutation(fields[0], fields[1], fields[2]);
+    }
+
+    /**
+     * \brief Serializes the permutation into a text form
+     * 
+     * The text consists of the universe, the seed and the prime as decimal numbers separated by colons.
+     * 
+     * \return the text form
+     */
+    std::string to_string() const {
+        return std::to_string(universe_) + ":" + std::to_string(seed()) + ":" + std::to_string(prime());
+    }
+
+    /**
+     * \brief Restores a permutation from its text form without searching the prime
+     * 
+     * \param text the text form as obtained by \ref to_string
+     * \return the permutation
+     * \throws std::invalid_argument if the text does not describe a valid permutation of this width
+     */
+    static BasicRandomPermutation from_string(std::string_view const text) {
+        uint64_t fields[3];
+        char const* p = text.data();
+        char const* const end = text.data() + text.size();
+        for(size_t i = 0; i < 3; i++) {
+            if(i > 0 && (p == end || *p++ != ':')) throw std::invalid_argument("malformed permutation: expected a colon");
+            auto const result = std::from_chars(p, end, fields[i]);
+            if(result.ec != std::errc()) throw std::invalid_argument("malformed permutation: expected a number");
+            p = result.ptr;
+        }
+        if(p != end) throw std::invalid_argument("malformed permutation: trailing characters");
+        return BasicRandomPermutation(fields[0], fields[1], fields[2]);
+    }
+
+    /**
+     * \brief Returns an iterator over the entire permutation
+     * 
+     * \return an iterator over the entire permutation
+     */
+    constexpr Iterator begin() const { return Iterator(*this, 0); }
+
+    /**
+     * \brief Returns an iterator starting at the i-th number of the permutation
+     * 
+     * \param i the number to start from
+     * \return an iterator starting at the i-th number of the permutation 
+     */
+    constexpr Iterator at(UInt i) const { return Iterator(*this, i); }
+
+    /**
+     * \brief Returns the end iterator of the permutation
+     * 
+     * \return the end iterator
+     */
+    constexpr Iterator end() const { return Iterator(*this, typename Iterator::difference_type(universe_) + 1); }
+
+    /**
+     * \brief Returns the number of positions covered by \ref begin and \ref end
+     * 
+     * This is one more than the universe, which may exceed the range of \c UInt.
+     * 
+     * \return the number of positions
+     */
+    constexpr wide_t<UInt> size() const { return wide_t<UInt>(universe_) + 1; }
+
+    /**
+     * \brief Returns a range over the entire permutation that computes the numbers in chunks using \ref fill
+     * 
+     * This makes ranged for loops benefit from the batch kernels.
+     * 
+     * \param chunk the number of numbers to compute at a time
+     * \return the buffered range
+     */
+    BufferedView<BasicRandomPermutation> buffered(size_t const chunk = 256) const { return BufferedView<BasicRandomPermutation>(*this, chunk); }
+};
+
+/**
+ * \brief The random permutation generator for universes up to 2^64-1
+ */
+using RandomPermutation = BasicRandomPermutation<uint64_t>;
+
+/**
+ * \brief The random permutation generator for universes up to 2^32-1, which does not need 128-bit arithmetic
+ */
+using RandomPermutation32 = BasicRandomPermutation<uint32_t>;
+
+/**
+ * \brief The random permutation generator for universes up to 2^16-1, which does not need 64-bit arithmetic
+ */
+using RandomPermutation16 = BasicRandomPermutation<uint16_t>;
+
+/**
+ * \brief A single-pass range over a random permutation that computes the numbers in chunks
+ * 
+ * The range holds a copy of the permutation and a buffer that is refilled using \ref BasicRandomPermutation::fill
+ * whenever it has been consumed. Like the permutation's own iterators, it covers the numbers from zero up to and including the universe.
+ * 
+ * \tparam Perm the permutation type
+ */
+template<typename Perm>
+class BufferedView : public std::ranges::view_interface<BufferedView<Perm>> {
+private:
+    using UInt = typename Perm::value_type;
+
+    Perm perm_;
+    std::vector<UInt> buffer_;
+    wide_t<UInt> next_; // the next number to compute
+    size_t pos_;        // the current position in the buffer
+    size_t size_;       // the number of computed numbers in the buffer
+
+    void refill() {
+        size_t const n = size_t(std::min(wide_t<UInt>(buffer_.size()), perm_.size() - next_));
+        perm_.fill(UInt(next_), std::span<UInt>(buffer_.data(), n));
+        next_ += n;
+        pos_ = 0;
+        size_ = n;
     }
 
+    class Iterator {
+    private:
+        BufferedView* view_;
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using difference_type  = std::ptrdiff_t;
+        using value_type       = UInt;
+
+        Iterator() : view_(nullptr) {}
+        Iterator(BufferedView& view) : view_(&view) {}
+
+        inline UInt operator*() const { return view_->buffer_[view_->pos_]; }
+        inline Iterator& operator++() { if(++view_->pos_ == view_->size_) view_->refill(); return *this; }
+        inline void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return view_->size_ == 0; }
+    };
+
+public:
+    /**
+     * \brief Constructs a buffered range over the given permutation
+     * 
+     * \param perm the permutation
+     * \param chunk the number of numbers to compute at a time
+     */
+    BufferedView(Perm const& perm, size_t const chunk) : perm_(perm), buffer_(std::max(chunk, size_t(1))), next_(0), pos_(0), size_(0) {}
+
+    BufferedView(BufferedView const&) = delete;
+    BufferedView(BufferedView&&) = default;
+    BufferedView& operator=(BufferedView const&) = delete;
+    BufferedView& operator=(BufferedView&&) = default;
+
+    /**
+     * \brief Returns an iterator over the permutation
+     * 
+     * As the range is single-pass, this may be called only once.
+     * 
+     * \return an iterator over the permutation
+     */
+    Iterator begin() { refill(); return Iterator(*this); }
+
+    /**
+     * \brief Returns the end sentinel of the range
+     * 
+     * \return the end sentinel
+     */
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+};
+
+/**
+ * \brief A random permutation whose universe and seed are fixed at compile time
+ * 
+ * The prime is found by the compiler and numbers can be permuted in constant expressions.
+ * At runtime, the modulo by the known prime compiles to multiplications and shifts, and there is no initialization cost.
+ * The numbers are of the narrowest unsigned integer type that fits the universe.
+ * 
+ * For the same universe and seed, this produces the same permutation as \ref BasicRandomPermutation.
+ * 
+ * \tparam Universe the size of the universe
+ * \tparam Seed the random seed
+ */
+template<uint64_t Universe, uint64_t Seed>
+class StaticRandomPermutation : public std::ranges::view_interface<StaticRandomPermutation<Universe, Seed>> {
+    static_assert(Universe > 0, "the universe must not be empty");
+
+public:
+    using value_type = std::conditional_t<(Universe <= UINT16_MAX), uint16_t, std::conditional_t<(Universe <= UINT32_MAX), uint32_t, uint64_t>>;
+
+    /**
+     * \brief The largest universe for which \ref table can be used
+     */
+    static constexpr uint64_t MAX_TABLE_UNIVERSE = pow2(16);
+
+private:
+    using UInt = value_type;
+    template<typename U> using Reduction = width_traits<UInt>::template constant_reduction<U>;
+    using Perm = BasicRandomPermutation<UInt, Reduction>;
+
+    static constexpr Perm perm_ = Perm(UInt(Universe), Seed);
+
+public:
     /**
      * \brief Computes the i-th number of the permutation
      * 
      * \param i the number to permute
      * \return the permuted number
      */
-    inline uint64_t operator()(uint64_t const i) const { return permute((seed_ + permute(i)) % universe_); }
+    constexpr UInt operator()(UInt const i) const { return perm_(i); }
+
+    /**
+     * \brief Computes the entire permutation
+     * 
+     * Assign the result to a \c constexpr variable to have the lookup table embedded into the binary.
+     * 
+     * \return the permuted numbers of 0, 1, ..., Universe-1
+     */
+    static constexpr std::array<UInt, Universe> table() requires(Universe <= MAX_TABLE_UNIVERSE) {
+        std::array<UInt, Universe> t;
+        for(uint64_t i = 0; i < Universe; i++) t[i] = perm_(UInt(i));
+        return t;
+    }
 
     /**
      * \brief Returns an iterator over the entire permutation
      * 
      * \return an iterator over the entire permutation
      */
-    Iterator begin() const { return Iterator(*this, 0); }
+    constexpr auto begin() const { return perm_.begin(); }
 
     /**
      * \brief Returns an iterator starting at the i-th number of the permutation
@@ -187,14 +737,21 @@ public:
      * \param i the number to start from
      * \return an iterator starting at the i-th number of the permutation 
      */
-    Iterator at(uint64_t i) const { return Iterator(*this, i); }
+    constexpr auto at(UInt i) const { return perm_.at(i); }
 
     /**
      * \brief Returns the end iterator of the permutation
      * 
      * \return the end iterator
      */
-    Iterator end() const { return Iterator(*this, universe_+1, true); }
+    constexpr auto end() const { return perm_.end(); }
+
+    /**
+     * \brief Returns the number of positions covered by \ref begin and \ref end
+     * 
+     * \return the number of positions
+     */
+    constexpr auto size() const { return perm_.size(); }
 };
 
 }
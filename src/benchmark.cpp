@@ -0,0 +1,133 @@
+/**
+ * benchmark.cpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <random_permutation.hpp>
+
+#include <tlx/cmdline_parser.hpp>
+
+using namespace random_permutation;
+
+// measures the time per element for generating num elements of a permutation
+// streaming evaluates consecutive indices, chained feeds each result back as the next index (one-off random access)
+// and fill uses the batch API on blocks of consecutive indices
+template<typename Perm>
+void bench(char const* name, uint64_t const u, uint64_t const seed, uint64_t const num) {
+    auto perm = Perm(u, seed);
+
+    using UInt = typename Perm::value_type;
+
+    uint64_t chk = 0;
+    auto const t0 = std::chrono::high_resolution_clock::now();
+    for(uint64_t i = 0; i < num; i++) {
+        chk ^= perm(i);
+    }
+    auto const t1 = std::chrono::high_resolution_clock::now();
+    UInt x = 0;
+    for(uint64_t i = 0; i < num; i++) {
+        x = perm(x);
+    }
+    auto const t2 = std::chrono::high_resolution_clock::now();
+    chk ^= x;
+
+    uint64_t fchk = 0;
+    std::vector<UInt> block(4096);
+    auto const t3 = std::chrono::high_resolution_clock::now();
+    for(uint64_t i = 0; i < num; i += block.size()) {
+        perm.fill(i, block);
+        for(auto const y : block) fchk += y;
+    }
+    auto const t4 = std::chrono::high_resolution_clock::now();
+    chk ^= (fchk & 1);
+
+    double const ns_stream = std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)num;
+    double const ns_chain = std::chrono::duration<double, std::nano>(t2 - t1).count() / (double)num;
+    double const ns_fill = std::chrono::duration<double, std::nano>(t4 - t3).count() / (double)num;
+    std::cout << "width=" << std::setw(2) << std::numeric_limits<typename Perm::value_type>::digits
+              << " universe=" << std::setw(20) << std::left << u
+              << " reduction=" << std::setw(16) << std::left << name
+              << std::fixed << std::setprecision(2)
+              << " ns/element(streaming)=" << std::setw(6) << ns_stream
+              << " ns/element(chained)=" << std::setw(6) << ns_chain
+              << " ns/element(fill)=" << std::setw(6) << ns_fill
+              << " chk=" << std::hex << chk << std::dec << std::endl;
+}
+
+int main(int argc, char** argv) {
+    uint64_t seed = random_permutation::timestamp();
+    uint64_t num = 10'000'000ULL;
+    unsigned isa = (unsigned)IsaLevel::x86_64_v4;
+
+    tlx::CmdlineParser cp;
+    cp.set_description("Measures the time needed to generate permutations of common universes.");
+    cp.set_author("Patrick Dinklage");
+    cp.add_bytes('n', "num", num, "The number of numbers to generate per universe (default: 10M).");
+    cp.add_size_t('s', "seed", seed, "The random seed (default: high-res timestamp).");
+    cp.add_unsigned('i', "isa", isa, "The highest x86-64 instruction set level to use for batch kernels: 0, 3 or 4 (default: 4).");
+
+    if(!cp.process(argc, argv)) {
+        return -1;
+    }
+
+    limit_isa_level((IsaLevel)isa);
+    std::cout << "isa level=" << (unsigned)isa_level() << std::endl;
+
+    // the common universes have pseudo-Mersenne primes, 10^12 has a general one
+    for(uint64_t const u : { pow2(32) - 1, pow2(48) - 1, UINT64_MAX, uint64_t(1'000'000'000'000ULL) }) {
+        bench<BasicRandomPermutation<uint64_t, DivisionReduction>>("division", u, seed, num);
+        bench<BasicRandomPermutation<uint64_t, MontgomeryReduction>>("montgomery", u, seed, num);
+        bench<BasicRandomPermutation<uint64_t, BarrettReduction>>("barrett", u, seed, num);
+        if(PseudoMersenneReduction<uint64_t>::applicable(RandomPermutation(u, seed).prime())) {
+            bench<BasicRandomPermutation<uint64_t, PseudoMersenneReduction>>("pseudo-mersenne", u, seed, num);
+        }
+    }
+
+    // 32-bit engine
+    {
+        uint64_t const u = pow2(32) - 1;
+        bench<BasicRandomPermutation<uint32_t, DivisionReduction>>("division", u, seed, num);
+        bench<BasicRandomPermutation<uint32_t, MontgomeryReduction>>("montgomery", u, seed, num);
+        bench<BasicRandomPermutation<uint32_t, BarrettReduction>>("barrett", u, seed, num);
+        bench<BasicRandomPermutation<uint32_t, PseudoMersenneReduction>>("pseudo-mersenne", u, seed, num);
+    }
+
+    // 16-bit engine
+    {
+        uint64_t const u = pow2(16) - 1;
+        bench<BasicRandomPermutation<uint16_t, DivisionReduction>>("division", u, seed, num);
+        bench<BasicRandomPermutation<uint16_t, MontgomeryReduction>>("montgomery", u, seed, num);
+        bench<BasicRandomPermutation<uint16_t, BarrettReduction>>("barrett", u, seed, num);
+        bench<BasicRandomPermutation<uint16_t, PseudoMersenneReduction>>("pseudo-mersenne", u, seed, num);
+    }
+    return 0;
+}
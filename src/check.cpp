@@ -0,0 +1,573 @@
+/**
+ * check.cpp
+ * part of pdinklag/random_permutation
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2022 Patrick Dinklage
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <random_permutation.hpp>
+
+using namespace random_permutation;
+
+namespace {
+
+unsigned failures = 0;
+
+// seeds to check with, including some that make the offset by the seed wrap around 2^64
+// the permutation stores the seed xor-ed with two constants, so these are chosen to end up right below 2^64
+constexpr uint64_t SEEDS[] = {
+    0ULL,
+    1ULL,
+    0x0123456789ABCDEFULL,
+    0xFFFFFFFFFFFFFFFFULL,
+    (0xFFFFFFFFFFFFFFFFULL ^ 0xD2165B4B66592AD6ULL) ^ 0x9696594B6A5936B2ULL,
+    (0xFFFFFFFFFFFF0000ULL ^ 0xD2165B4B66592AD6ULL) ^ 0x9696594B6A5936B2ULL,
+};
+
+// universes with pseudo-Mersenne primes, others and tiny ones
+constexpr uint64_t UNIVERSES[] = {
+    UINT64_MAX, (1ULL << 48) - 1, 1'000'000'000'000ULL, 1'234'567'890'123'456'789ULL,
+    (1ULL << 32) - 1, (1ULL << 32) - 5, 1'000'000'007ULL, 123'456'789ULL,
+    (1ULL << 16) - 1, 50'000ULL, 10'007ULL, 1'000ULL,
+};
+
+// the number of consecutive numbers checked per start, enough to cover the vector kernels and the scalar tail
+constexpr size_t NUM = 1000;
+
+// compares fill against the scalar operator() for starts at and around the beginning and the end of the universe
+template<typename UInt, template<typename> typename Reduction, typename Out>
+void check_fill(char const* name, uint64_t const universe) {
+    using Perm = BasicRandomPermutation<UInt, Reduction>;
+    if(universe > std::numeric_limits<UInt>::max()) return;
+    if(universe - 1 > std::numeric_limits<Out>::max()) return;
+    if constexpr(std::is_same_v<Reduction<UInt>, PseudoMersenneReduction<UInt>>) {
+        if(!PseudoMersenneReduction<UInt>::applicable(UInt(RandomPermutation(universe, 0).prime()))) return;
+    }
+
+    std::vector<Out> out(NUM);
+    for(uint64_t const seed : SEEDS) {
+        auto const perm = Perm(universe, seed);
+        for(uint64_t const first : { uint64_t(0), uint64_t(1), universe / 2, universe - NUM, universe - 7, universe - 1, universe }) {
+            // a few sizes to cover the remainder of the vector kernels
+            for(size_t const n : { NUM, NUM - 1, size_t(13), size_t(1) }) {
+                std::span<Out> const span(out.data(), n);
+                perm.fill(UInt(first), span);
+                for(size_t i = 0; i < n; i++) {
+                    Out const expect = Out(perm(UInt(first + i)));
+                    if(span[i] != expect) {
+                        std::cerr << "fill mismatch: reduction=" << name << " width=" << std::numeric_limits<UInt>::digits
+                                  << " output width=" << std::numeric_limits<Out>::digits << " isa=" << (unsigned)isa_level()
+                                  << " universe=" << universe << " seed=" << seed << " first=" << first << " i=" << i
+                                  << ": got " << (uint64_t)span[i] << ", expected " << (uint64_t)expect << std::endl;
+                        ++failures;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// the original definition of the permutation, which all widths and reduction policies must reproduce exactly
+struct BaselinePermutation {
+    uint64_t universe, seed, prime;
+
+    BaselinePermutation(uint64_t const universe, uint64_t const seed, uint64_t const prime)
+        : universe(universe), seed((seed ^ 0x9696594B6A5936B2ULL) ^ 0xD2165B4B66592AD6ULL), prime(prime) {}
+
+    uint64_t permute(uint64_t const x) const {
+        if(x >= prime) return x;
+        uint64_t const r = (__uint128_t(x) * __uint128_t(x)) % __uint128_t(prime);
+        return (x <= (prime >> 1)) ? r : prime - r;
+    }
+
+    uint64_t operator()(uint64_t const i) const { return permute((seed + permute(i)) % universe); }
+};
+
+// tests whether the prime is the greatest prime p <= universe satisfying p = 3 (mod 4), independently of the prime search
+bool is_expected_prime(uint64_t const universe, uint64_t const prime) {
+    if(prime > universe || (prime != 0 && ((prime & 3) != 3 || !internal::is_prime(prime)))) return false;
+    for(uint64_t q = prime + 4 - (prime & 3) + 3; q > prime && q <= universe; q += 4) {
+        if(internal::is_prime(q)) return false;
+    }
+    return true;
+}
+
+// compares operator() against the original definition of the permutation near the beginning, middle and end of the universe
+template<typename UInt, template<typename> typename Reduction>
+void check_baseline(char const* name, uint64_t const universe) {
+    using Perm = BasicRandomPermutation<UInt, Reduction>;
+    if(universe > std::numeric_limits<UInt>::max()) return;
+    if constexpr(std::is_same_v<Reduction<UInt>, PseudoMersenneReduction<UInt>>) {
+        if(!PseudoMersenneReduction<UInt>::applicable(UInt(RandomPermutation(universe, 0).prime()))) return;
+    }
+
+    uint64_t const prime = Perm(universe, 0).prime();
+    if(!is_expected_prime(universe, prime)) {
+        std::cerr << "wrong prime: reduction=" << name << " width=" << std::numeric_limits<UInt>::digits
+                  << " universe=" << universe << ": got " << prime << std::endl;
+        ++failures;
+        return;
+    }
+
+    constexpr uint64_t RANGE = 300;
+    for(uint64_t const seed : SEEDS) {
+        auto const perm = Perm(universe, seed);
+        BaselinePermutation const baseline(universe, seed, perm.prime());
+        for(uint64_t const first : { uint64_t(0), universe / 2, universe - std::min(universe, RANGE) }) {
+            for(uint64_t i = first; i < first + RANGE && i < universe; i++) {
+                uint64_t const expect = baseline(i);
+                if(perm(UInt(i)) != expect) {
+                    std::cerr << "baseline mismatch: reduction=" << name << " width=" << std::numeric_limits<UInt>::digits
+                              << " universe=" << universe << " seed=" << seed << " i=" << i
+                              << ": got " << (uint64_t)perm(UInt(i)) << ", expected " << expect << std::endl;
+                    ++failures;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// verifies that inverse undoes operator() and vice versa near the beginning, middle and end of the universe
+template<typename UInt, template<typename> typename Reduction>
+void check_inverse(char const* name, uint64_t const universe) {
+    using Perm = BasicRandomPermutation<UInt, Reduction>;
+    if(universe > std::numeric_limits<UInt>::max()) return;
+    if constexpr(std::is_same_v<Reduction<UInt>, PseudoMersenneReduction<UInt>>) {
+        if(!PseudoMersenneReduction<UInt>::applicable(UInt(RandomPermutation(universe, 0).prime()))) return;
+    }
+
+    auto report = [&](char const* what, uint64_t const seed, uint64_t const i, uint64_t const got, uint64_t const expect) {
+        std::cerr << what << " mismatch: reduction=" << name << " width=" << std::numeric_limits<UInt>::digits
+                  << " universe=" << universe << " seed=" << seed << " i=" << i << ": got " << got << ", expected " << expect << std::endl;
+        ++failures;
+    };
+
+    constexpr uint64_t RANGE = 300;
+    constexpr size_t SPAN_SIZES[] = { 1, 3, 4, 5, 13, RANGE - 1, RANGE }; // the last one covers the range
+    std::vector<UInt> in(RANGE), out(RANGE);
+    for(uint64_t const seed : SEEDS) {
+        auto const perm = Perm(universe, seed);
+
+        // if adding the seed overflows 64 bits, two positions may be mapped to the same number and some numbers do not occur
+        bool const bijective = BaselinePermutation(universe, seed, 0).seed <= UINT64_MAX - (universe - 1);
+
+        for(uint64_t const first : { uint64_t(0), universe / 2, universe - std::min(universe, RANGE) }) {
+            uint64_t const last = std::min(first + RANGE, universe);
+            for(uint64_t x = first; x < last; x++) {
+                UInt const y = perm(UInt(x));
+                UInt const z = perm.inverse(y);
+                if(bijective ? z != x : perm(z) != y) {
+                    report("inverse(operator())", seed, x, z, x);
+                    break;
+                }
+            }
+            if(bijective) {
+                for(uint64_t y = first; y < last; y++) {
+                    UInt const z = perm(perm.inverse(UInt(y)));
+                    if(z != y) {
+                        report("operator()(inverse)", seed, y, z, y);
+                        break;
+                    }
+                }
+            }
+
+            // the span overload, with sizes that are not multiples of the numbers inverted at once, and in place
+            size_t const n = size_t(last - first);
+            for(size_t i = 0; i < n; i++) in[i] = perm(UInt(first + i));
+            for(size_t const size : SPAN_SIZES) {
+                size_t const m = std::min(size, n);
+                perm.inverse(std::span<UInt const>(in.data(), m), std::span<UInt>(out.data(), m));
+                for(size_t i = 0; i < m; i++) {
+                    if(out[i] != perm.inverse(in[i])) {
+                        report("inverse(span)", seed, first + i, out[i], perm.inverse(in[i]));
+                        break;
+                    }
+                }
+            }
+            perm.inverse(std::span<UInt const>(in.data(), n), std::span<UInt>(in.data(), n));
+            for(size_t i = 0; i < n; i++) {
+                if(in[i] != out[i]) {
+                    report("in-place inverse(span)", seed, first + i, in[i], out[i]);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+template<template<typename> typename Reduction>
+void check_inverse_all(char const* name) {
+    for(uint64_t const u : UNIVERSES) {
+        check_inverse<uint64_t, Reduction>(name, u);
+        check_inverse<uint32_t, Reduction>(name, u);
+        check_inverse<uint16_t, Reduction>(name, u);
+    }
+}
+
+// tests whether two permutations describe the same permutation, comparing their state and the numbers at the start and the end
+template<typename Perm>
+bool same_permutation(Perm const& a, Perm const& b) {
+    if(a.universe() != b.universe() || a.seed() != b.seed() || a.prime() != b.prime()) return false;
+    uint64_t const universe = a.universe();
+    for(uint64_t i = 0; i < std::min<uint64_t>(universe, 100); i++) {
+        if(a(typename Perm::value_type(i)) != b(typename Perm::value_type(i))) return false;
+        if(a(typename Perm::value_type(universe - 1 - i)) != b(typename Perm::value_type(universe - 1 - i))) return false;
+    }
+    return true;
+}
+
+// tests whether calling f throws std::invalid_argument
+template<typename F>
+bool throws_invalid_argument(F&& f) {
+    try {
+        f();
+    } catch(std::invalid_argument const&) {
+        return true;
+    } catch(...) {
+        return false;
+    }
+    return false;
+}
+
+// verifies that the binary and the text form reproduce the permutation and that invalid ones are rejected
+template<typename UInt, template<typename> typename Reduction>
+void check_serialization(char const* name) {
+    using Perm = BasicRandomPermutation<UInt, Reduction>;
+    auto report = [&](char const* what, auto const& detail) {
+        std::cerr << what << ": reduction=" << name << " width=" << std::numeric_limits<UInt>::digits << " " << detail << std::endl;
+        ++failures;
+    };
+
+    for(uint64_t const universe : UNIVERSES) {
+        if(universe > std::numeric_limits<UInt>::max()) continue;
+        if constexpr(std::is_same_v<Reduction<UInt>, PseudoMersenneReduction<UInt>>) {
+            if(!PseudoMersenneReduction<UInt>::applicable(UInt(RandomPermutation(universe, 0).prime()))) continue;
+        }
+
+        for(uint64_t const seed : SEEDS) {
+            auto const perm = Perm(universe, seed);
+            std::string const text = perm.to_string();
+            if(!same_permutation(perm, Perm::deserialize(perm.serialize()))) report("serialize round trip mismatch", text);
+            if(!same_permutation(perm, Perm::from_string(text))) report("to_string round trip mismatch", text);
+
+            // the binary form of a 64-bit permutation can be restored for a narrower width
+            if(!same_permutation(perm, Perm::deserialize(RandomPermutation(universe, seed).serialize()))) report("cross-width round trip mismatch", text);
+        }
+    }
+
+    // the prime of 1000 is 991, and 1019 is the next prime p = 3 (mod 4)
+    constexpr uint64_t UNIVERSE = 1000;
+    struct Invalid { uint64_t universe, prime; };
+    constexpr Invalid INVALID[] = {
+        { UNIVERSE, 15 },   // composite, 3 mod 4
+        { UNIVERSE, 9 },    // composite, 1 mod 4
+        { UNIVERSE, 13 },   // prime, but 1 mod 4
+        { UNIVERSE, 1019 }, // prime and 3 mod 4, but larger than the universe
+        { UNIVERSE, 0 },    // no prime although the universe is large enough
+        { 0, 0 },           // empty universe
+    };
+    for(Invalid const& e : INVALID) {
+        std::string const text = std::to_string(e.universe) + ":1:" + std::to_string(e.prime);
+        if(!throws_invalid_argument([&](){ Perm(e.universe, 1, e.prime); })) report("constructor accepted an invalid prime", text);
+        if(!throws_invalid_argument([&](){ Perm::from_string(text); })) report("from_string accepted an invalid prime", text);
+
+        // patch the prime into a valid blob
+        auto blob = Perm(UNIVERSE, 1).serialize();
+        for(size_t i = 0; i < 8; i++) {
+            blob[i] = std::byte(e.universe >> (i * 8));
+            blob[16 + i] = std::byte(e.prime >> (i * 8));
+        }
+        if(!throws_invalid_argument([&](){ Perm::deserialize(blob); })) report("deserialize accepted an invalid prime", text);
+    }
+
+    for(std::string_view const text : { "", "abc", "1000", "1000:1", "1000:1:", "1000:1:991:4", "1000:x:991", "1000::991",
+                                        "-1000:1:991", "1000:1:991 ", " 1000:1:991", "1000;1;991", "1000:1:99999999999999999999" }) {
+        if(!throws_invalid_argument([&](){ Perm::from_string(text); })) report("from_string accepted malformed text", text);
+    }
+    if(!same_permutation(Perm(UNIVERSE, 1), Perm::from_string("1000:1:991"))) report("from_string rejected valid text", "1000:1:991");
+
+    // universes that exceed the width
+    if constexpr(std::numeric_limits<UInt>::digits < 64) {
+        uint64_t const universe = uint64_t(std::numeric_limits<UInt>::max()) + 1;
+        if(!throws_invalid_argument([&](){ Perm::deserialize(RandomPermutation(universe, 1).serialize()); })) {
+            report("deserialize accepted a universe exceeding the width", universe);
+        }
+    }
+}
+
+template<template<typename> typename Reduction>
+void check_serialization_all(char const* name) {
+    check_serialization<uint64_t, Reduction>(name);
+    check_serialization<uint32_t, Reduction>(name);
+    check_serialization<uint16_t, Reduction>(name);
+}
+
+template<template<typename> typename Reduction>
+void check_fill_all(char const* name) {
+    for(uint64_t const u : UNIVERSES) {
+        check_fill<uint64_t, Reduction, uint64_t>(name, u);
+        check_fill<uint64_t, Reduction, uint32_t>(name, u);
+        check_fill<uint32_t, Reduction, uint32_t>(name, u);
+        check_fill<uint32_t, Reduction, uint64_t>(name, u);
+        check_fill<uint16_t, Reduction, uint16_t>(name, u);
+        check_fill<uint16_t, Reduction, uint32_t>(name, u);
+    }
+}
+
+template<template<typename> typename Reduction>
+void check_baseline_all(char const* name) {
+    for(uint64_t const u : UNIVERSES) {
+        check_baseline<uint64_t, Reduction>(name, u);
+        check_baseline<uint32_t, Reduction>(name, u);
+        check_baseline<uint16_t, Reduction>(name, u);
+    }
+}
+
+// verifies the precomputed primes of the common universes against the prime search
+void check_common_universes() {
+    for(internal::CommonUniverse const& e : internal::COMMON_UNIVERSES) {
+        uint64_t const expect = internal::search_prime_3mod4(e.universe);
+        if(e.prime != expect) {
+            std::cerr << "common universe mismatch: universe=" << e.universe << ": got " << e.prime << ", expected " << expect << std::endl;
+            ++failures;
+        }
+    }
+    std::cout << "checked " << std::size(internal::COMMON_UNIVERSES) << " common universes" << std::endl;
+}
+
+// verifies the batch prime search against the search for single universes
+void check_find_primes() {
+    // clustered universes, duplicates, common universes and tiny ones
+    std::vector<uint64_t> universes;
+    for(uint64_t const u : UNIVERSES) {
+        for(uint64_t d : { 0, 1, 2, 3, 4, 5, 17, 100, 1000, 100'000 }) {
+            if(u > d) universes.push_back(u - d);
+        }
+    }
+    for(uint64_t u = 1; u < 100; u++) universes.push_back(u);
+    universes.insert(universes.end(), { 1'000'000'000'000ULL, 1'000'000'000'000ULL, 4'000'000'000ULL, 4'000'000'000ULL, 1ULL });
+
+    auto verify = [&](char const* what) {
+        auto const primes = find_primes_3mod4(universes);
+        for(size_t i = 0; i < universes.size(); i++) {
+            uint64_t const expect = internal::search_prime_3mod4(universes[i]);
+            if(primes[i] != expect || internal::find_prime_3mod4(universes[i]) != expect) {
+                std::cerr << "find_primes_3mod4 mismatch (" << what << "): universe=" << universes[i]
+                          << ": got " << primes[i] << ", expected " << expect << std::endl;
+                ++failures;
+            }
+        }
+    };
+
+    disable_prime_memo();
+    verify("no memo");
+    enable_prime_memo();
+    verify("empty memo");
+    verify("filled memo"); // all universes are cache hits now
+    std::cout << "checked find_primes_3mod4" << std::endl;
+}
+
+// compares parallel_fill and parallel_for_each against fill for several numbers of threads and sizes around the chunk boundaries
+void check_parallel() {
+    constexpr size_t CHUNK = internal::PARALLEL_CHUNK;
+    constexpr size_t SIZES[] = { 0, 1, CHUNK - 1, CHUNK, CHUNK + 1, 3 * CHUNK + 5 };
+
+    auto const perm = RandomPermutation(1'000'000'007ULL, 0x0123456789ABCDEFULL);
+    std::vector<uint64_t> expect(SIZES[std::size(SIZES) - 1]);
+    perm.fill(0, std::span<uint64_t>(expect));
+
+    std::vector<uint64_t> out;
+    std::vector<unsigned> visits;
+    for(unsigned const threads : { 1U, 2U, 3U, 4U, 0U }) {
+        for(size_t const n : SIZES) {
+            out.assign(n, 0);
+            parallel_fill(perm, std::span<uint64_t>(out), threads);
+            if(!std::equal(out.begin(), out.end(), expect.begin())) {
+                std::cerr << "parallel_fill mismatch: threads=" << threads << " n=" << n << std::endl;
+                ++failures;
+            }
+
+            // a range that does not start at a chunk boundary
+            uint64_t const first = 3;
+            visits.assign(n, 0);
+            out.assign(n, 0);
+            parallel_for_each(perm, first, first + n, [&](uint64_t const i, uint64_t const x) {
+                ++visits[i - first]; // every position is visited by a single thread
+                out[i - first] = x;
+            }, threads);
+            for(size_t i = 0; i < n; i++) {
+                if(visits[i] != 1 || out[i] != perm(first + i)) {
+                    std::cerr << "parallel_for_each mismatch: threads=" << threads << " n=" << n << " i=" << first + i
+                              << ": visited " << visits[i] << " time(s), got " << out[i] << ", expected " << perm(first + i) << std::endl;
+                    ++failures;
+                    break;
+                }
+            }
+        }
+    }
+    std::cout << "checked parallel_fill and parallel_for_each" << std::endl;
+}
+
+#ifdef RANDOM_PERMUTATION_DISK_CACHE
+// verifies that the prime cache file keeps structured universes, which only differ in their high bits
+void check_disk_cache() {
+    auto const path = (std::filesystem::temp_directory_path() / "random_permutation_check.bin").string();
+    std::filesystem::remove(path);
+    {
+        constexpr uint64_t NUM_KEYS = 5000;
+        internal::DiskPrimeCache cache(path, 65536);
+        if(!cache.is_open()) {
+            std::cerr << "failed to open the prime cache file " << path << std::endl;
+            ++failures;
+            return;
+        }
+
+        for(uint64_t k = 1; k <= NUM_KEYS; k++) cache.insert(k << 20, k);
+
+        uint64_t kept = 0;
+        for(uint64_t k = 1; k <= NUM_KEYS; k++) {
+            uint64_t prime;
+            kept += (cache.lookup(k << 20, prime) && prime == k);
+        }
+        if(kept != NUM_KEYS) {
+            std::cerr << "prime cache file kept only " << kept << " of " << NUM_KEYS << " structured universes" << std::endl;
+            ++failures;
+        }
+    }
+    std::filesystem::remove(path);
+
+    // primes read from the file must be validated, invalid ones are replaced
+    struct Corrupt { uint64_t universe, prime; };
+    constexpr Corrupt CORRUPT[] = {
+        { 1'000'000'000'123ULL, 999'999'999'999ULL }, // composite
+        { 1'000'000'000'223ULL, 1'000'000'000'037ULL }, // 1 mod 4 (and not a prime)
+        { 5'000'123ULL, 13ULL },                        // prime, but 1 mod 4
+        { 5'000'223ULL, 1'000'000'007ULL },             // prime and 3 mod 4, but larger than the universe
+    };
+    auto corrupt = [&](){
+        internal::DiskPrimeCache cache(path, 1024);
+        for(Corrupt const& e : CORRUPT) cache.insert(e.universe, e.prime);
+    };
+    auto verify = [&](char const* what, uint64_t const universe, uint64_t const prime) {
+        if(prime != internal::search_prime_3mod4(universe)) {
+            std::cerr << what << " used an invalid prime from the cache file: universe=" << universe << ", prime=" << prime << std::endl;
+            ++failures;
+        }
+    };
+
+    disable_prime_memo();
+    corrupt();
+    if(!enable_prime_cache(path)) {
+        std::cerr << "failed to enable the prime cache file " << path << std::endl;
+        ++failures;
+    } else {
+        for(Corrupt const& e : CORRUPT) verify("construction", e.universe, RandomPermutation(e.universe, 0).prime());
+        disable_prime_cache();
+
+        corrupt();
+        enable_prime_cache(path);
+        std::vector<uint64_t> universes;
+        for(Corrupt const& e : CORRUPT) universes.push_back(e.universe);
+        auto const primes = find_primes_3mod4(universes);
+        for(size_t i = 0; i < universes.size(); i++) verify("find_primes_3mod4", universes[i], primes[i]);
+        disable_prime_cache();
+
+        // the invalid primes have been replaced
+        internal::DiskPrimeCache cache(path, 1024);
+        for(Corrupt const& e : CORRUPT) {
+            uint64_t prime = 0;
+            cache.lookup(e.universe, prime);
+            verify("the cache file", e.universe, prime);
+        }
+    }
+    enable_prime_memo();
+    std::filesystem::remove(path);
+
+    std::cout << "checked prime cache file" << std::endl;
+}
+#endif
+
+}
+
+int main() {
+    check_common_universes();
+    check_find_primes();
+#ifdef RANDOM_PERMUTATION_DISK_CACHE
+    check_disk_cache();
+#endif
+
+    check_baseline_all<AdaptiveReduction>("adaptive");
+    check_baseline_all<DivisionReduction>("division");
+    check_baseline_all<MontgomeryReduction>("montgomery");
+    check_baseline_all<BarrettReduction>("barrett");
+    check_baseline_all<PseudoMersenneReduction>("pseudo-mersenne");
+    std::cout << "checked operator() against the baseline" << std::endl;
+
+    check_inverse_all<AdaptiveReduction>("adaptive");
+    check_inverse_all<DivisionReduction>("division");
+    check_inverse_all<MontgomeryReduction>("montgomery");
+    check_inverse_all<BarrettReduction>("barrett");
+    check_inverse_all<PseudoMersenneReduction>("pseudo-mersenne");
+    std::cout << "checked inverse" << std::endl;
+
+    check_serialization_all<AdaptiveReduction>("adaptive");
+    check_serialization_all<DivisionReduction>("division");
+    check_serialization_all<MontgomeryReduction>("montgomery");
+    check_serialization_all<BarrettReduction>("barrett");
+    check_serialization_all<PseudoMersenneReduction>("pseudo-mersenne");
+    std::cout << "checked serialization" << std::endl;
+
+    IsaLevel const detected = isa_level();
+    for(IsaLevel const level : { IsaLevel::baseline, IsaLevel::x86_64_v3, IsaLevel::x86_64_v4 }) {
+        if(level > detected) break;
+        limit_isa_level(level);
+        check_fill_all<AdaptiveReduction>("adaptive");
+        check_fill_all<DivisionReduction>("division");
+        check_fill_all<MontgomeryReduction>("montgomery");
+        check_fill_all<BarrettReduction>("barrett");
+        check_fill_all<PseudoMersenneReduction>("pseudo-mersenne");
+        std::cout << "checked fill at isa level " << (unsigned)level << std::endl;
+    }
+    check_parallel();
+
+    if(failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -29,6 +29,7 @@
 #include <chrono>
 #include <cstddef>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include <random_permutation.hpp>
@@ -40,6 +41,8 @@ int main(int argc, char** argv) {
     uint64_t seed = random_permutation::timestamp();
     uint64_t num = 10ULL;
     bool check = false;
+    std::string prime_cache;
+    unsigned threads = 1;
 
     tlx::CmdlineParser cp;
     cp.set_description("Generates a random permutation of a universe and prints it to the standard output.");
@@ -47,6 +50,8 @@ int main(int argc, char** argv) {
     cp.add_bytes('n', "num", num, "The number of numbers to generate (default: 10).");
     cp.add_bytes('u', "universe", u, "The universe to draw numbers from (default: 32-bit numbers).");
     cp.add_size_t('s', "seed", seed, "The random seed (default: high-res timestamp).");
+    cp.add_string('p', "prime-cache", prime_cache, "A prime cache file to consult and extend, created if it does not exist (default: none).");
+    cp.add_unsigned('t', "threads", threads, "The number of threads used to search the prime, 0 for all hardware threads (default: 1).");
 #ifndef NDEBUG
     cp.add_flag('c', "check", check, "Check that a permutation is generated (debug).");
 #endif
@@ -60,6 +65,12 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    random_permutation::set_prime_search_threads(threads);
+    if(!prime_cache.empty() && !random_permutation::enable_prime_cache(prime_cache)) {
+        std::cerr << "failed to open prime cache file: " << prime_cache << std::endl;
+        return -1;
+    }
+
     // generate numbers
     auto perm = random_permutation::RandomPermutation(u, seed);
 